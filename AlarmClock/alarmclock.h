@@ -26,6 +26,10 @@
 #include <SDL2_gfxPrimitives.h>
 #include <SDL_ttf.h>
 #include <univalue.h>
+#include <unordered_map>
+#include <functional>
+#include <bitset>
+#include <atomic>
 
 #define WINDOW_WIDTH 800
 #define WINDOW_HEIGHT 480
@@ -52,6 +56,16 @@ typedef struct SDL_Size {
 	int h;
 } SDL_Size;
 
+#define ATLAS_PAGE_SIZE 1024
+
+// A picture on the GPU, either packed into one of the shared atlas pages or in a texture of its own
+struct SPRITE {
+	SDL_Texture* tex = NULL;
+	SDL_Rect rc = { 0, 0, 0, 0 }; // where the picture is in tex
+	SDL_Size tex_size = { 0, 0 }; // size of all of tex
+	int page = -1; // atlas page, -1 = tex belongs to this sprite (usually from the texture pool)
+};
+
 #include "menus.h"
 #include "status_bar.h"
 #include "config.h"
@@ -78,19 +92,25 @@ struct CONFIG_COLORS {
 };
 extern const CONFIG_COLORS colors;
 
+class Scene;
+
 class Page {
 public:
 	virtual void Tick() {};
 
 	virtual void OnActivate() {};
+	virtual void OnDeactivate() {}; // another page is taking over, stop its timers
 	virtual void OnDarkChanged() {}
+	virtual void OnRenderTargetsReset() {} // the contents of any target textures are gone
 	virtual void OnClick(const SDL_Point& pt) {}
 
-	virtual void Render() = 0;
+	virtual void Render() = 0; // draws the whole page, used when GetScene() is NULL or there's no backbuffer
+	virtual Scene* GetScene() { return NULL; } // pages with a scene only redraw what changed
 };
 
 void SetNextPage(shared_ptr<Page>& p);
 void switch_to_clock();
+shared_ptr<Menu> create_menu_settings();
 void switch_to_menu_settings();
 void switch_to_menu(shared_ptr<Menu>& menu);
 
@@ -103,6 +123,36 @@ struct ALARM_TIME {
 	}
 };
 
+// An alarm from the alarm table ("alarms" in settings.json), on top of the ones the menus set. See alarms.cpp
+struct ALARM {
+	string label;
+	ALARM_TIME time;
+	uint8 days = 0; // a bit per day of the week, Sunday is bit 0. None for a one-time alarm
+	int every_weeks = 1; // 2 for every other week, counted from the week start is in
+	int64 start = 0; // the first day it can go off, in days since 1970-01-01 local time. A one-time alarm with one only goes off that day
+	string sound; // a file in resources/alarms, empty for a random one
+	bool enabled = true;
+
+	bool isOneTime() const { return days == 0; }
+	time_t NextAt(time_t from) const; // the first time it goes off at or after from, 0 if it never does
+};
+
+// Every table alarm's next time, soonest first
+class AlarmIndex {
+public:
+	void Build(const vector<ALARM>& alarms, time_t from);
+	time_t Next() const { return heap.empty() ? 0 : heap.front().first; }
+	// Takes out the alarms due at or before when and puts the ones that repeat back at their next time after it
+	void PopDue(const vector<ALARM>& alarms, time_t when, vector<size_t>& due);
+	size_t size() const { return heap.size(); }
+
+private:
+	vector<pair<time_t, size_t>> heap; // next time and index in the table, a min-heap on the time
+};
+void AlarmToUniValue(const ALARM& a, UniValue& obj);
+bool AlarmFromUniValue(ALARM& a, const UniValue& obj);
+void alarm_table_benchmark();
+
 enum TIME_FORMATS {
 	TF_12HOUR_SUFFIX,
 	TF_12HOUR_PLAIN,
@@ -116,6 +166,7 @@ public:
 	bool dim_when_dark = true;
 	bool auto_enable_at_midnight = false;
 	bool flip_clock_style = false;
+	bool show_seconds = false; // only used by the regular clock face
 	TIME_FORMATS time_format = TF_12HOUR_SUFFIX;
 	// If there is no activity, it will return to the clock display after this long
 #ifdef DEBUG
@@ -127,15 +178,22 @@ public:
 	ALARM_TIME one_time_alarm;
 	ALARM_TIME alarm_time;
 	ALARM_TIME daily_alarms[7];
+	vector<ALARM> alarms;
+	// alarm_time and daily_alarms by minute of the week (Sunday 00:00 is bit 0). Rebuilt by AlarmsChanged()
+	bitset<7 * 1440> alarm_minutes;
 
 	void ToUniValue(UniValue& obj);
 	bool FromUniValue(const UniValue& obj);
 
-	bool ShouldAlarmAt(time_t ts, struct tm* ptm = NULL);
-	time_t GetNextAlarmTime() const;
+	void AlarmsChanged(); // rebuilds alarm_minutes, call after changing the alarm times
+	bool ShouldAlarmAt(const struct tm& tm) const;
+	bool ConsumeOneTimeAlarm(const struct tm& tm); // clears the one-time alarm if it's the one at tm, the caller saves it
+	time_t FindNextAlarm(time_t from) const; // the first menu alarm at or after from, up to a week ahead. 0 if there isn't one
 	time_t GetNextAlarmTime(time_t tme) const;
-	time_t GetNextAlarmTime(const struct tm& tm) const;
+	time_t GetNextAlarmTime(const struct tm& day, time_t from) const; // the first menu alarm on day's date at or after from
 };
+void alarm_benchmark(int days);
+bool alarm_test(); // -test=alarms
 
 class HomeAssistantInfo {
 public:
@@ -152,26 +210,83 @@ public:
 };
 bool GetHomeAssistantInfo(HomeAssistantInfo& info);
 
+// What the logic thread publishes for the UI, see logic.cpp. Never changed once it's published
+struct UI_STATE {
+	uint64 generation = 0; // goes up every time something in it changes
+	bool alarming = false;
+	bool is_dark = false;
+	bool enable_alarm = false;
+	time_t next_alarm = 0; // the alarm scheduler's next one, menu or alarm table
+	HomeAssistantInfo ha;
+};
+
+#define TIMER_LEVELS 4
+#define TIMER_SLOTS 64
+
+// One thread's timers and deadlines, see timer_wheel.cpp. Only use it from the thread it belongs to
+class TimerWheel {
+public:
+	typedef uint64 ID;
+
+	TimerWheel(Uint64 (*ticks)() = SDL_GetTicks64) : ticks(ticks) {} // ticks is the clock it runs on, for -test=timers
+
+	ID Add(Uint64 ms, function<void()> fn, Uint64 repeat = 0); // runs fn in ms, then every repeat ms if it's set
+	ID AddAt(Uint64 when, function<void()> fn, Uint64 repeat = 0); // when is an SDL_GetTicks64() time
+	ID AddWallClock(int secs, function<void()> fn); // runs fn every time the wall clock reaches a multiple of secs, ie. 60 = every whole minute
+	void Set(ID& id, Uint64 ms, function<void()> fn); // moves a one-shot timer, or adds it if id isn't set
+	void Cancel(ID& id); // and sets id to 0
+	bool IsSet(ID id) const;
+	void WakeWithin(Uint64 ms); // makes sure the thread wakes up within ms without running anything
+
+	void Run(); // runs every timer that's due
+	Uint64 NextDeadline() const; // SDL_GetTicks64() time of the earliest timer, 0 if there aren't any
+	Uint32 TimeoutMs(Uint32 max_ms) const; // how long the thread can sleep
+	string Stats() const;
+
+private:
+	struct TIMER {
+		Uint64 due;
+		Uint64 repeat;
+		int wall_secs;
+		function<void()> fn;
+	};
+	unordered_map<ID, TIMER> timers;
+	vector<ID> slots[TIMER_LEVELS][TIMER_SLOTS];
+	Uint64 cur_tick = 0; // the last tick Run() got to
+	ID last_id = 0;
+	ID wake_id = 0;
+	uint64 runs = 0;
+	Uint64 (*ticks)();
+
+	void Start();
+	void Insert(ID id, Uint64 due, bool cascading = false);
+	void Cascade(int level);
+};
+bool timer_wheel_test(); // -test=timers
+
 void load_dynamic_settings();
 void save_dynamic_settings();
 void update_lcd_brightness();
 
 class CONFIG {
 private:
+	// owned by the logic thread, the UI uses config.ui
 	bool _alarming = false;
 	bool _is_dark = false;
 
 	bool got_lcd_brightness = false;
 	uint8 cur_lcd_brightness = 0;
 public:
-	bool shutdown_now = false;
+	atomic<bool> shutdown_now{ false }; // every thread polls it
 	FILE* log_fp = NULL;
 
-	ConfigOptions options;
+	ConfigOptions options; // owned by the UI, the logic thread has a copy (logic_options())
+	shared_ptr<const UI_STATE> ui = make_shared<UI_STATE>(); // the main thread's copy of the latest UI_STATE, swapped by ui_state_update()
 
 	const bool& alarming = _alarming;
-	void Alarm();
-	void ClearAlarm();
+	void Alarm(const string& sound = ""); // sound is a file in resources/alarms, empty for a random one
+	string alarm_sound; // logic thread, the sound of the alarm that's going off
+	void ClearAlarm(); // any thread, it's done on the logic thread
 
 	bool use_sun = false;
 	const bool& is_dark = _is_dark;
@@ -194,13 +309,29 @@ public:
 			}
 			return false;
 		}
-		HomeAssistantInfo info;
+		HomeAssistantInfo info; // owned by the logic thread
 	} home_assistant;
 
 	Uint32 fps = 0;
 	Uint32 fps_target = 0;
 	uint32 cur_frame = 0;
 
+	// In event-driven mode the main loop sleeps in SDL_WaitEventTimeout() until the next deadline and only renders dirty frames
+	bool event_driven = true;
+	atomic<bool> needs_redraw{ true }; // set from any thread through request_redraw()
+	TimerWheel timers; // the main thread's, the loop sleeps until the next one is due
+	Uint32 wake_event = 0; // user event type other threads push to wake up the main loop
+	SDL_threadID main_thread = 0;
+
+	bool show_frame_stats = false;
+	bool prewarm = true; // open fonts and render common text in a worker thread at startup
+	bool async_text = true; // render text that isn't cached yet on the text worker thread
+	int texture_budget = 64; // MB of textures before the least recently used ones get evicted, 0 = no limit
+	bool raster_cache = true; // keep rendered digits, labels and icons in the data dir for the next start
+	bool resource_pack = true; // use resources.pak when it's there
+	int alarm_late_minutes = 60; // an alarm missed by more than this (the clock jumped ahead or the logic thread stalled) doesn't go off
+	uint64 first_clock_frame_ms = 0; // from process start to the first clock frame on screen
+
 	bool fullscreen = false;
 	SDL_Window* mWnd = NULL;
 	SDL_Renderer* mRenderer = NULL;
@@ -239,13 +370,147 @@ enum SB_SECTIONS {
 #ifdef DEBUG_FPS
 	SB_FPS,
 #endif
+	SB_FRAME_STATS, // only exists when show_frame_stats is enabled
 };
 void statusbar_set(SB_SECTIONS sec, const string& str);
 void statusbar_set_progress(SB_SECTIONS sec, size_t cur, size_t max);
 extern SDL_StatusBar status_bar;
 
-TTF_Font* GetFontSize(int ptSize);
+enum FRAME_PHASES {
+	// logic thread
+	FP_ALARM_LOOP,
+	FP_TICK_30S,
+	FP_HOME_ASSISTANT,
+	FP_LOGIC, // a whole logic thread pass, not counting time spent waiting
+	FP_ALARM_LATENCY, // from an alarm or midnight coming due to the logic thread handling it
+	// main thread
+	FP_EVENTS,
+	FP_INPUT_LATENCY, // from SDL timestamping a click or key press to the main loop handling it
+	FP_PAGE_TICK,
+	FP_PAGE_RENDER,
+	FP_PRESENT,
+	FP_FRAME, // a whole main loop iteration, not counting time spent waiting for events
+	FP_NUM_PHASES
+};
+
+class FrameHistogram {
+public:
+	static const int NUM_BUCKETS = 104;
+	uint32 buckets[NUM_BUCKETS] = { 0 };
+	uint64 count = 0;
+	uint64 total_us = 0;
+	uint64 max_us = 0;
+
+	void Add(uint64 us);
+	uint64 Percentile(double p) const; // p = 0-100, returns microseconds
+	void Reset();
+};
+
+// Times the scope it lives in and adds it to the histogram for that phase
+class FrameTimer {
+private:
+	FRAME_PHASES phase;
+	Uint64 start;
+	bool stopped = false;
+public:
+	static Uint64 Now();
+
+	FrameTimer(FRAME_PHASES pphase) : phase(pphase), start(Now()) {}
+	~FrameTimer() {
+		Stop();
+	}
+	void Stop();
+};
+
+void frame_stats_add(FRAME_PHASES phase, Uint64 perf_ticks); // perf_ticks is in SDL_GetPerformanceCounter() units. Any thread
+void frame_stats_add_us(FRAME_PHASES phase, uint64 us);
+FrameHistogram frame_stats_get(FRAME_PHASES phase); // a copy, the logic thread might be adding to it
+void frame_stats_update_readout();
+bool frame_stats_dump(); // writes frame_stats.txt to the data dir
+
+void request_redraw(); // Marks the screen dirty so the main loop renders it, safe to call from any thread
+void schedule_wakeup(Uint64 ms); // Makes sure the main loop wakes up within ms milliseconds, config.timers.WakeWithin()
+
+// Logic thread: alarms, alarm audio, light/dark and Home Assistant merges, see logic.cpp
+void start_logic_thread();
+void logic_clear();
+bool on_logic_thread();
+ConfigOptions& logic_options(); // the logic thread's copy of config.options, only use it on the logic thread
+void logic_set_options(const ConfigOptions& opts); // hands the logic thread a new copy, save_dynamic_settings() does this
+void logic_post(function<void()> fn); // runs fn on the logic thread
+void logic_wake();
+void logic_schedule_wakeup(Uint64 ms); // schedule_wakeup() for the logic thread
+void main_post(function<void()> fn); // runs fn on the main thread
+void main_run_posted(); // main loop
+shared_ptr<const UI_STATE> ui_state_get(); // the latest published state, any thread
+void ui_state_update(); // main loop, swaps config.ui for the latest state
+void alarm_loop();
+void alarm_schedule_changed(); // the alarm times changed, the next alarm is worked out again. Logic thread
+time_t alarm_next_due(); // the next alarm the scheduler has lined up, 0 if there isn't one. Logic thread
+void tick_30s();
+
+/*
+* One font file, loaded into memory once. Every point size is opened from that same copy, so extra sizes only cost the
+* FreeType face and its glyph cache instead of another read of the file.
+*/
+class FontFile {
+private:
+	string fn;
+	const uint8* data = NULL;
+	size_t data_len = 0;
+	bool mapped = false; // data is an mmap() of the file, otherwise it points into buf or the resource pack
+	bool packed = false; // data is in the resource pack
+	string buf;
+	bool load_failed = false;
+	map<int, TTF_Font*> sizes;
+
+	bool Load();
+	TTF_Font* openSize(int ptSize);
+public:
+	FontFile(const string& pfn) : fn(pfn) {}
+	FontFile(const FontFile&) = delete;
+	FontFile& operator=(const FontFile&) = delete;
+
+	TTF_Font* GetSize(int ptSize);
+	TTF_Font* OpenPrivate(int ptSize); // not shared or cached, the caller closes it with ClosePrivateFont()
+	uint64 Hash(uint64 h); // h with the file's contents hashed into it
+	string Stats();
+	void Reset(); // closes every size and unmaps the file
+};
+
+TTF_Font* GetFontSize(int ptSize); // render thread faces, shared by everything drawing on it
 TTF_Font* GetMonoFontSize(int ptSize);
+TTF_Font* OpenPrivateFontSize(int ptSize); // a face of the regular font for another thread to use, close with ClosePrivateFont()
+void ClosePrivateFont(TTF_Font* font);
+void close_fonts();
+uint64 font_files_hash(uint64 h); // h with both font files hashed into it
+string font_stats();
+
+// Menu icons shared by every MenuItem, packed into one texture, see image_cache.cpp
+void image_cache_load(); // packs everything in resources/images, done at startup and again after the texture budget evicts it
+const SPRITE* image_cache_get(const string& image); // image is a file name in resources/images. Only good until the end of the frame, NULL if it can't be loaded
+void image_cache_draw(const SPRITE& icon, const SDL_Rect& container); // scaled to fit container, keeping its aspect ratio
+void image_cache_clear();
+string image_cache_stats();
+
+// Fonts, decoded menu icons and the alarm sound list packed into one mapped file, see resource_pack.cpp
+bool resource_pack_build(); // -build_resource_pack, writes resources.pak from the loose files in resources/
+void resource_pack_open(); // before the fonts are loaded
+void resource_pack_close(); // after everything using packed data is gone
+bool resource_pack_find(const string& fn, const uint8*& data, size_t& len); // a packed file's contents, false to read the loose file instead
+SDL_Surface* resource_load_image(const string& fn); // a decoded image the caller frees, from the pack or else the raster cache or the loose file
+bool resource_list(const string& dir, vector<string>& files); // the files in dir, from the pack if it covers it
+string resource_pack_stats();
+void resource_benchmark(int rounds);
+
+// Rasterized digit atlases, menu labels and icons kept in the data dir between runs, see raster_cache.cpp
+uint64 hash_bytes(uint64 h, const void* data, size_t len);
+void raster_cache_load(); // after the window and fonts are set up
+SDL_Surface* raster_cache_get(const string& key, string* extra = NULL); // an ARGB8888 copy the caller frees, NULL if it isn't cached. Any thread
+void raster_cache_put(const string& key, SDL_Surface* src, const string& extra = ""); // copies src. Any thread
+void raster_cache_save(bool force = false); // writes it out if anything was added, at most once a minute unless forced. Blocks on the write, so not on the render thread
+void raster_cache_clear();
+string raster_cache_stats();
 
 void draw_text(TTF_Font* font, int x, int y, const SDL_Color& col, const char* str, int style = TTF_STYLE_NORMAL);
 void draw_text(TTF_Font* font, int x, int y, const SDL_Color& col, const vector<string>& lines, int style = TTF_STYLE_NORMAL);
@@ -262,13 +527,191 @@ void draw_text(int ptSize, const SDL_Rect& rc, uint8 align, const SDL_Color& col
 void draw_text_wrapped(TTF_Font* font, const SDL_Rect& rc, uint8 align, const SDL_Color& col, const string& str, int style = TTF_STYLE_NORMAL); // doesn't size down font to fit rc
 void draw_text_wrapped(int ptSize, const SDL_Rect& rc, uint8 align, const SDL_Color& col, const string& str, int style = TTF_STYLE_NORMAL); // sizes down font if needed to fit rc
 
+enum TEXT_FIT_FLAGS {
+	TFF_WIDTH = 1,
+	TFF_HEIGHT = 2,
+	TFF_WRAPPED = 4 // measure as word wrapped to box.w
+};
+/*
+* Measures text and caches the results. A TTF_Font can only be used by one thread at a time, so each thread that fits text
+* needs its own fitter with its own faces.
+*/
+class TextFitter {
+private:
+	struct FONT_SIZE_METRICS {
+		int height = 0;
+		int line_skip = 0;
+		int space_w = 0;
+	};
+
+	function<TTF_Font* (int)> get_font;
+	unordered_map<string, int> fit_memo;
+	unordered_map<string, SDL_Size> text_metrics; // single-line sizes, keyed by size, style and string
+	map<pair<int, int>, FONT_SIZE_METRICS> font_metrics; // by size and style
+	uint64 fit_hits = 0, fit_misses = 0;
+	uint64 metric_hits = 0, metric_misses = 0;
+
+	SDL_Size measureLine(int ptSize, int style, const string& str);
+	SDL_Size measureWrapped(int ptSize, int style, const string& str, int wrap_width);
+	const FONT_SIZE_METRICS& getFontMetrics(int ptSize, int style);
+	bool fits(int ptSize, const string& str, const SDL_Size& box, int style, uint8 flags);
+public:
+	TextFitter(function<TTF_Font* (int)> pget_font) : get_font(pget_font) {}
+
+	TTF_Font* GetFont(int ptSize) {
+		return get_font(ptSize);
+	}
+	// Returns the largest point size from min_size to max_size that str fits in box with, or min_size if none do. flags = TEXT_FIT_FLAGS
+	int FitSize(const string& str, int max_size, const SDL_Size& box, int style, uint8 flags, int min_size = 10);
+	void Merge(const TextFitter& other); // copies the other fitter's answers into this one
+	string Stats() const;
+};
+
+extern TextFitter text_fitter; // the render thread's fitter, draw_text*() and friends go through this one
+int text_fit_size(const string& str, int max_size, const SDL_Size& box, int style, uint8 flags, int min_size = 10);
+void text_fit_merge(const TextFitter& other);
+string text_fit_stats();
+
+enum TEXTURE_OWNER {
+	TO_ATLAS,
+	TO_TEXT,
+	TO_GLYPHS,
+	TO_SHAPES,
+	TO_IMAGES,
+	TO_FLIP_FACE,
+	TO_BACKBUFFER,
+	TO_POOL, // idle streaming textures waiting to be reused
+	TO_OTHER,
+	TO_COUNT
+};
+// Texture registry: tracks GPU memory by owner and evicts the least recently used textures over config.texture_budget
+SDL_Texture* texture_create(TEXTURE_OWNER owner, Uint32 format, int access, int w, int h);
+SDL_Texture* texture_create_from_surface(TEXTURE_OWNER owner, SDL_Surface* src);
+void texture_destroy(SDL_Texture* tex);
+void texture_set_owner(SDL_Texture* tex, TEXTURE_OWNER owner);
+void texture_touch(SDL_Texture* tex); // marks it as used this frame, used textures are never evicted
+void texture_set_evict(SDL_Texture* tex, function<void()> evict); // evict has to free tex with texture_destroy()/sprite_free() and forget it, the owner makes it again when it's needed
+void texture_budget_end_frame();
+void texture_report_leaks();
+string texture_stats();
+
+// Streaming textures for big sprites, bucketed by size and reused instead of being destroyed
+SDL_Texture* texture_pool_acquire(TEXTURE_OWNER owner, int w, int h, SDL_Size& tex_size); // tex_size = the whole texture, at least w x h
+bool texture_pool_upload(SDL_Texture* tex, SDL_Surface* src); // copies src into the top left
+bool texture_pool_release(SDL_Texture* tex); // false if tex isn't from the pool
+void texture_pool_clear();
+string texture_pool_stats();
+
+bool sprite_create(SDL_Surface* src, SPRITE& s, TEXTURE_OWNER owner, bool allow_atlas = true); // frees whatever s had first, doesn't free src. owner is only used if it gets its own texture
+void sprite_free(SPRITE& s);
+bool atlas_white(SDL_Texture* prefer, SDL_Texture*& tex, SDL_Rect& rc); // a solid white block on prefer's page, or the first page
+void atlas_clear();
+string atlas_stats();
+
+// Sprites are white and tinted with col. clip trims the quad itself, so it doesn't touch the renderer's clip rect
+void draw_sprite(const SPRITE& s, const SDL_Rect& dest, const SDL_Color& col, const SDL_Rect* clip = NULL);
+void draw_sprite_part(const SPRITE& s, const SDL_Rect& src, const SDL_Rect& dest, const SDL_Color& col, const SDL_Rect* clip = NULL); // src is relative to the sprite
+void draw_fill(const SDL_Rect& rc, const SDL_Color& col);
+void draw_outline(const SDL_Rect& rc, const SDL_Color& col); // same pixels as SDL_RenderDrawRect()
+struct BATCH_COUNTERS {
+	uint64 frames = 0;
+	uint64 quads = 0;
+	uint64 draw_calls = 0;
+	uint64 texture_switches = 0;
+	uint64 forced_flushes = 0; // flushes because something drew with the renderer directly
+};
+void batch_begin();
+void batch_flush(bool forced = true); // call before drawing with the renderer directly or changing the target/clip/viewport
+void batch_flush_texture(SDL_Texture* tex); // call before changing the pixels of a texture that might have quads waiting
+void batch_end();
+BATCH_COUNTERS batch_totals(); // since startup
+string batch_stats();
+
+// Everything that affects what a draw_text*() call rasterizes. Text is cached white and tinted when it's drawn, so the color isn't part of it
+struct TEXT_CACHE_KEY {
+	TTF_Font* font = NULL; // NULL when the text is sized to fit
+	int ptSize = 0; // starting point size when the text is sized to fit
+	int style = TTF_STYLE_NORMAL;
+	int wrap_width = 0; // 0 = single line
+	SDL_Size fit = { 0, 0 }; // size of the rect the text was fit to, 0x0 = not sized
+	uint8 align = 0; // only set for wrapped text, where it changes the rendered surface
+	string str;
+	size_t hash = 0;
+
+	TEXT_CACHE_KEY() {}
+	TEXT_CACHE_KEY(TTF_Font* pfont, int pptSize, int pstyle, int pwrap_width, int fit_w, int fit_h, uint8 palign, const string& pstr);
+	bool operator==(const TEXT_CACHE_KEY& b) const;
+};
+struct TEXT_CACHE_KEY_HASH {
+	size_t operator()(const TEXT_CACHE_KEY& k) const {
+		return k.hash;
+	}
+};
+const SPRITE* text_cache_find(const TEXT_CACHE_KEY& key); // NULL if it isn't cached, marks the entry as used this frame
+const SPRITE* text_cache_add(const TEXT_CACHE_KEY& key, SDL_Surface* src, bool pinned = false); // doesn't free src, the cache owns the returned sprite. pinned = never evicted for being unused
+void text_cache_end_frame(); // drops textures that haven't been drawn in a while
+void text_cache_clear();
+string text_cache_stats();
+
+enum TEXT_JOB_TYPES {
+	TJ_FIXED, // draw_text(GetFontSize(ptSize), rc, ...)
+	TJ_FIXED_WRAPPED, // draw_text_wrapped(GetFontSize(ptSize), rc, ...)
+	TJ_FIT, // draw_text(ptSize, rc, ...)
+	TJ_FIT_WRAPPED // draw_text_wrapped(ptSize, rc, ...)
+};
+// A draw_text*() call that can be rasterized ahead of time or on another thread
+struct TEXT_JOB {
+	TEXT_JOB_TYPES type = TJ_FIT;
+	int ptSize = 0;
+	SDL_Rect rc = { 0 };
+	uint8 align = 0;
+	SDL_Color col = { 0 };
+	string str;
+	int style = TTF_STYLE_NORMAL;
+};
+TEXT_CACHE_KEY text_job_key(const TEXT_JOB& job); // the key the equivalent draw_text*() call would use
+SDL_Surface* text_job_render(const TEXT_JOB& job, TextFitter& fitter); // renders white with fitter's faces, the caller frees the surface
+void draw_text(const TEXT_JOB& job);
+
+// Same coverage as roundedBoxRGBA()/roundedRectangleRGBA() from rc.x,rc.y to rc.x+rc.w,rc.y+rc.h, but drawn from cached nine-slice textures
+void draw_rounded_box(const SDL_Rect& rc, int rad, const SDL_Color& col);
+void draw_rounded_rect(const SDL_Rect& rc, int rad, const SDL_Color& col);
+void shape_cache_clear();
+string shape_cache_stats();
+void shape_benchmark(int frames);
+
+/*
+* Text worker: renders TEXT_JOBs on its own thread so the render thread only uploads finished surfaces. While a job is
+* in flight draw_text(job), CachedText and the status bar keep drawing the text they had before.
+*/
+void start_text_worker();
+bool text_async_enabled();
+uint32 text_async_request(const TEXT_JOB& job); // returns a ticket for text_async_take()
+void text_async_request_cached(const TEXT_CACHE_KEY& key, const TEXT_JOB& job); // the result goes into the text cache under key, dupes are ignored
+bool text_async_take(uint32 ticket, SDL_Surface*& src); // true when the job is done, src is NULL if it failed. The caller frees src
+void text_async_cancel(uint32 ticket); // 0 is ignored
+void text_async_process(); // uploads finished text cache jobs, call from the main loop
+void text_async_note_pending();
+uint64 text_async_pending_draws(); // goes up every time something couldn't draw its current text yet, so cached pages know to redraw
+bool text_sprite_update(uint32& ticket, const TEXT_JOB& job, SPRITE& spr); // replaces spr with job's text, returns false while it's still being rendered and leaves spr alone
+void text_async_clear();
+string text_async_stats();
+void text_benchmark(int frames);
+
+void start_prewarm();
+void prewarm_upload(); // hands finished pre-warm work over to the render thread, call from the main loop
+void prewarm_clear();
+
 class CachedText {
 private:
 	string _str;
-	SDL_Texture* tex = NULL;
-	SDL_Size tex_size = { 0 };
+	SPRITE spr;
+	bool stale = false; // spr is from an older text/rect
+	uint32 ticket = 0; // text worker request for the new texture
 	SDL_Color _col = { 0 };
 	SDL_Rect _rc = { 0 };
+
+	SDL_Rect destRect() const;
 public:
 	const string& str = _str;
 	const SDL_Color& col = _col;
@@ -283,33 +726,44 @@ public:
 		if (pstr != str) {
 			_str = pstr;
 			clearCache();
+			request_redraw();
 		}
 	}
 	void setColor(const SDL_Color& pcol) {
 		if (memcmp(&col, &pcol, sizeof(SDL_Color))) {
+			// the texture is white, the color is applied when it's drawn
 			_col = pcol;
-			clearCache();
+			request_redraw();
 		}
 	}
 	void setRect(const SDL_Rect& prc) {
 		if (memcmp(&rc, &prc, sizeof(SDL_Rect))) {
 			_rc = prc;
 			clearCache();
+			request_redraw();
 		}
 	}
 
+	void Update(); // brings the sprite up to date with the text, Draw() calls it too
+	void GetState(string& state); // appends everything Draw() output depends on
+	SDL_Rect GetBounds(); // where the text lands, clipped to rc. Empty until there's a sprite
 	void Draw();
 
+	// The old sprite is kept and drawn until the new one is ready
 	void clearCache() {
-		if (tex != NULL) {
-			SDL_DestroyTexture(tex);
-			tex = NULL;
-		}
+		stale = true;
+		text_async_cancel(ticket);
+		ticket = 0;
+	}
+	void freeSprite() {
+		text_async_cancel(ticket);
+		ticket = 0;
+		sprite_free(spr);
 	}
 
 	CachedText() {}
 	~CachedText() {
-		clearCache();
+		freeSprite();
 	}
 
 	// Delete the copy constructor
@@ -318,14 +772,76 @@ public:
 	CachedText& operator=(const CachedText&) = delete;
 };
 
+// Draws clock times from per-size atlases of pre-rendered glyphs, so a new time doesn't rasterize or upload anything
+class DigitAtlas {
+private:
+	static const char* glyph_chars;
+	static const int NUM_GLYPHS = 13;
+	struct ATLAS {
+		SPRITE spr;
+		int height = 0;
+		SDL_Rect glyphs[NUM_GLYPHS] = {};
+	};
+	map<int, ATLAS> atlases; // by point size
+	map<string, int> fit_sizes; // digit pattern -> point size that fits rc
+	string str;
+	SDL_Color col = { 0xFF, 0xFF, 0xFF, 0xFF };
+	SDL_Rect rc = { 0 };
+
+	int getFitSize(const string& pstr);
+	SDL_Surface* renderGlyphs(int ptSize, ATLAS& atlas);
+	ATLAS* getAtlas(int ptSize);
+	ATLAS* layout(SDL_Rect& bounds);
+public:
+	static string Pattern(const string& str); // the string fit sizes are looked up by
+	int font_size = TIME_FONT_SIZE; // largest size it will try
+	uint8 align = DTA_CENTER | DTA_MIDDLE;
+
+	void setText(const string& pstr);
+	void setColor(const SDL_Color& pcol);
+	void setRect(const SDL_Rect& prc);
+
+	void GetState(string& state); // appends everything Draw() output depends on
+	SDL_Rect GetBounds(); // the glyphs of the current string, empty if there's nothing to draw
+	void Draw();
+	void Reset();
+
+	DigitAtlas() {}
+	~DigitAtlas() {
+		Reset();
+	}
+
+	DigitAtlas(const DigitAtlas&) = delete;
+	DigitAtlas& operator=(const DigitAtlas&) = delete;
+};
+
 void SDL_SetRenderDrawColor(SDL_Renderer* r, const SDL_Color& col);
 
+// Narrows the renderer's clip rect to rc (inside any clip that's already set) until it goes out of scope
+class ClipScope {
+private:
+	SDL_Rect old = { 0, 0, 0, 0 };
+	bool had_clip = false;
+public:
+	bool visible = true; // false if rc is completely outside the current clip, nothing would be drawn
+
+	ClipScope(const SDL_Rect& rc);
+	~ClipScope();
+
+	ClipScope(const ClipScope&) = delete;
+	ClipScope& operator=(const ClipScope&) = delete;
+};
+
 string ts_to_str(time_t ts);
-string tm_to_str(const tm& tm);
+string tm_to_str(const tm& tm, bool seconds = false);
 string FormatMinutes(int64 secs);
+Uint64 ms_until_next_interval(int secs); // Milliseconds until the wall clock reaches the next multiple of secs, ie. 60 = next whole minute
+time_t local_time_on(const struct tm& day, int hour, int minute); // The first time day's date shows hour:minute, 0 if DST skips it
 
 void start_home_assistant();
 void update_home_assistant();
 bool backup_file(const string& fn);
 
 SDL_Rect ScaleRectToFit(const SDL_Rect& source, const SDL_Rect& container);
+
+#include "scene.h"
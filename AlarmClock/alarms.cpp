@@ -0,0 +1,272 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2026 Drift Solutions
+
+#include "alarmclock.h"
+
+/*
+* The alarm table: any number of alarms in settings.json, each with its own days, every N weeks, a label and a sound.
+* It sits next to the one-time/daily/day of week alarms the menus set, which still go through the weekly bitmap.
+*
+* The logic thread keeps every table alarm's next time in a min-heap (AlarmIndex). Finding the next alarm is a look at
+* the top, and an alarm going off is a pop and a push of its next time, so a few hundred alarms cost about the same as a
+* few. The heap is only built again from scratch when the options change.
+*
+* "alarms": [
+*   { "label": "Kids, school days", "hour": 6, "minute": 45, "days": [1, 2, 3, 4, 5], "sound": "bell.ogg" },
+*   { "label": "Bins", "hour": 19, "minute": 0, "days": [3], "every_weeks": 2, "start": "2026-10-21" },
+*   { "label": "Flight", "hour": 4, "minute": 30, "start": "2026-11-02" },
+*   { "label": "Nap", "hour": 15, "minute": 0 }
+* ]
+* No days makes it a one-time alarm, on its start date or otherwise the next time it comes around, and it's turned off
+* once it's gone off. "enabled": false keeps one in the table without it going off.
+*/
+
+#define ALARM_MAX_EVERY_WEEKS 52
+
+// Days since 1970-01-01 for a date, and back (Howard Hinnant's algorithms). Doesn't care about time zones or DST
+static int64 days_from_civil(int64 y, int m, int d) {
+	y -= (m <= 2);
+	const int64 era = (y >= 0 ? y : y - 399) / 400;
+	const int64 yoe = y - era * 400;
+	const int64 doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+	const int64 doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	return era * 146097 + doe - 719468;
+}
+
+static void civil_from_days(int64 z, int& y, int& m, int& d) {
+	z += 719468;
+	const int64 era = (z >= 0 ? z : z - 146096) / 146097;
+	const int64 doe = z - era * 146097;
+	const int64 yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	const int64 doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	const int64 mp = (5 * doy + 2) / 153;
+	d = int(doy - (153 * mp + 2) / 5 + 1);
+	m = int(mp < 10 ? mp + 3 : mp - 9);
+	y = int(yoe + era * 400 + (m <= 2));
+}
+
+static int weekday_of(int64 day) {
+	// 1970-01-01 was a Thursday
+	return int(((day % 7) + 11) % 7);
+}
+
+static int64 floor_div(int64 a, int64 b) {
+	return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+time_t ALARM::NextAt(time_t from) const {
+	if (!enabled || !time.isValid()) {
+		return 0;
+	}
+
+	struct tm tm;
+	localtime_r(&from, &tm);
+	const int64 today = days_from_civil(tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday);
+	int64 first = max(today, start);
+	int64 last;
+	if (isOneTime()) {
+		if (start != 0 && start < today) {
+			return 0;
+		}
+		// its date, or today/tomorrow without one
+		last = (start != 0) ? start : today + 1;
+	} else {
+		// one whole cycle is enough to find it if it's ever going to happen
+		last = first + (7 * int64(every_weeks)) + 1;
+	}
+	const int64 week0 = floor_div(start - weekday_of(start), 7);
+
+	for (int64 day = first; day <= last; day++) {
+		if (!isOneTime()) {
+			if (!(days & (1 << weekday_of(day)))) {
+				continue;
+			}
+			if (every_weeks > 1 && (floor_div(day - weekday_of(day), 7) - week0) % every_weeks != 0) {
+				continue;
+			}
+		}
+
+		struct tm t = {};
+		civil_from_days(day, t.tm_year, t.tm_mon, t.tm_mday);
+		t.tm_year -= 1900;
+		t.tm_mon--;
+		// an alarm time DST skips doesn't go off that day and one it repeats goes off the first time, same as the
+		// other alarms
+		time_t ts = local_time_on(t, time.hour, time.minute);
+		if (ts > 0 && ts >= from) {
+			return ts;
+		}
+	}
+	return 0;
+}
+
+static bool heap_later(const pair<time_t, size_t>& a, const pair<time_t, size_t>& b) {
+	return a.first > b.first;
+}
+
+void AlarmIndex::Build(const vector<ALARM>& alarms, time_t from) {
+	heap.clear();
+	heap.reserve(alarms.size());
+	for (size_t i = 0; i < alarms.size(); i++) {
+		time_t ts = alarms[i].NextAt(from);
+		if (ts > 0) {
+			heap.push_back({ ts, i });
+		}
+	}
+	make_heap(heap.begin(), heap.end(), heap_later);
+}
+
+void AlarmIndex::PopDue(const vector<ALARM>& alarms, time_t when, vector<size_t>& due) {
+	while (!heap.empty() && heap.front().first <= when) {
+		pop_heap(heap.begin(), heap.end(), heap_later);
+		auto x = heap.back();
+		heap.pop_back();
+		due.push_back(x.second);
+		if (x.second < alarms.size() && !alarms[x.second].isOneTime()) {
+			time_t ts = alarms[x.second].NextAt(when + 60 - (when % 60));
+			if (ts > 0) {
+				heap.push_back({ ts, x.second });
+				push_heap(heap.begin(), heap.end(), heap_later);
+			}
+		}
+	}
+}
+
+static string day_to_str(int64 day) {
+	int y, m, d;
+	civil_from_days(day, y, m, d);
+	return mprintf("%04d-%02d-%02d", y, m, d);
+}
+
+static bool day_from_str(const string& str, int64& day) {
+	int y = 0, m = 0, d = 0;
+	if (sscanf(str.c_str(), "%d-%d-%d", &y, &m, &d) != 3 || m < 1 || m > 12 || d < 1 || d > 31) {
+		return false;
+	}
+	day = days_from_civil(y, m, d);
+	return true;
+}
+
+void AlarmToUniValue(const ALARM& a, UniValue& obj) {
+	obj.setObject();
+	if (!a.label.empty()) {
+		obj.pushKV("label", a.label);
+	}
+	obj.pushKV("hour", a.time.hour);
+	obj.pushKV("minute", a.time.minute);
+	if (!a.isOneTime()) {
+		UniValue days(UniValue::VARR);
+		for (int i = 0; i < 7; i++) {
+			if (a.days & (1 << i)) {
+				days.push_back(i);
+			}
+		}
+		obj.pushKV("days", days);
+	}
+	if (a.every_weeks > 1) {
+		obj.pushKV("every_weeks", a.every_weeks);
+	}
+	if (a.start != 0) {
+		obj.pushKV("start", day_to_str(a.start));
+	}
+	if (!a.sound.empty()) {
+		obj.pushKV("sound", a.sound);
+	}
+	if (!a.enabled) {
+		obj.pushKV("enabled", false);
+	}
+}
+
+bool AlarmFromUniValue(ALARM& a, const UniValue& obj) {
+	if (!obj.isObject()) {
+		return false;
+	}
+	if (obj.exists("label") && obj["label"].isStr()) {
+		a.label = obj["label"].get_str();
+	}
+	if (obj.exists("hour") && obj["hour"].isNum()) {
+		a.time.hour = obj["hour"].get_int();
+	}
+	if (obj.exists("minute") && obj["minute"].isNum()) {
+		a.time.minute = obj["minute"].get_int();
+	}
+	if (obj.exists("days") && obj["days"].isArray()) {
+		const UniValue& arr = obj["days"];
+		for (size_t i = 0; i < arr.size(); i++) {
+			if (arr[i].isNum() && arr[i].get_int() >= 0 && arr[i].get_int() <= 6) {
+				a.days |= (1 << arr[i].get_int());
+			}
+		}
+	}
+	if (obj.exists("every_weeks") && obj["every_weeks"].isNum()) {
+		a.every_weeks = min(max(obj["every_weeks"].get_int(), 1), ALARM_MAX_EVERY_WEEKS);
+	}
+	if (obj.exists("start") && obj["start"].isStr() && !day_from_str(obj["start"].get_str(), a.start)) {
+		printf("Alarm %s has a bad start date: %s\n", a.label.c_str(), obj["start"].get_str().c_str());
+	}
+	if (obj.exists("sound") && obj["sound"].isStr()) {
+		a.sound = obj["sound"].get_str();
+	}
+	if (obj.exists("enabled") && obj["enabled"].isBool()) {
+		a.enabled = obj["enabled"].getBool();
+	}
+	if (!a.time.isValid()) {
+		printf("Alarm %s has a bad time, ignoring it\n", a.label.c_str());
+		return false;
+	}
+	return true;
+}
+
+/*
+* Part of -benchmark=alarms: tables of growing size with random times, days and every 1-2 weeks. Times building the
+* index, each alarm going off over a simulated 4 weeks through the index, and finding the next alarm by scanning the
+* whole table like it would be without one.
+*/
+void alarm_table_benchmark() {
+	const size_t sizes[] = { 10, 100, 500, 1000 };
+	Uint64 freq = SDL_GetPerformanceFrequency();
+	time_t start = time(NULL);
+	start -= start % 60;
+	const time_t end = start + (28 * 86400);
+
+	for (size_t n : sizes) {
+		vector<ALARM> alarms(n);
+		for (auto& a : alarms) {
+			a.time.hour = dsl_get_random<int>(0, 23);
+			a.time.minute = dsl_get_random<int>(0, 59);
+			a.days = dsl_get_random<uint8>(1, 127);
+			a.every_weeks = dsl_get_random<int>(1, 2);
+		}
+
+		AlarmIndex index;
+		Uint64 t = SDL_GetPerformanceCounter();
+		index.Build(alarms, start);
+		double build_ms = double(SDL_GetPerformanceCounter() - t) * 1000.0 / double(freq);
+
+		vector<size_t> due;
+		size_t fires = 0;
+		t = SDL_GetPerformanceCounter();
+		while (index.Next() > 0 && index.Next() <= end) {
+			due.clear();
+			index.PopDue(alarms, index.Next(), due);
+			fires += due.size();
+		}
+		double pop_us = double(SDL_GetPerformanceCounter() - t) * 1000000.0 / double(freq) / double(max<size_t>(fires, 1));
+
+		// a sample is plenty, it's a full pass over the table each time
+		const int scans = 50;
+		t = SDL_GetPerformanceCounter();
+		for (int i = 0; i < scans; i++) {
+			time_t from = start + (i * 3600), best = 0;
+			for (auto& a : alarms) {
+				time_t ts = a.NextAt(from);
+				if (ts > 0 && (best == 0 || ts < best)) {
+					best = ts;
+				}
+			}
+		}
+		double scan_us = double(SDL_GetPerformanceCounter() - t) * 1000000.0 / double(freq) / double(scans);
+
+		printf("Alarm table of %4zu: index built in %.3f ms, %.3f us per alarm going off (%zu in 4 weeks), %.1f us per next alarm without the index\n", n, build_ms, pop_us, fires, scan_us);
+	}
+}
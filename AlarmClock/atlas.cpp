@@ -0,0 +1,278 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2026 Drift Solutions
+
+#include "alarmclock.h"
+
+/*
+* Shared atlas pages for UI sprites (text, shapes, glyphs). Small pictures get packed into a few big textures so a
+* page of menu buttons and labels can go out in a handful of SDL_RenderGeometry() batches instead of a copy per
+* texture. Pages are split into shelves of similar height; freed spots go on their shelf's free list and get reused by
+* the next sprite that fits. Anything too big, or that doesn't fit once every page is in use, gets its own texture from
+* the texture pool.
+*/
+
+#define ATLAS_MAX_PAGES 4
+#define ATLAS_MAX_SPRITE_W 512 // anything bigger gets its own texture
+#define ATLAS_MAX_SPRITE_H 256
+#define ATLAS_PADDING 1 // transparent gap between sprites so they can't bleed into each other
+#define ATLAS_WHITE_SIZE 4 // solid white block every page starts with, fills are drawn from it
+
+struct ATLAS_SPAN {
+	int x, w;
+};
+
+struct ATLAS_SHELF {
+	int y = 0, h = 0;
+	int next_x = ATLAS_PADDING;
+	vector<ATLAS_SPAN> free_spans;
+};
+
+struct ATLAS_PAGE {
+	SDL_Texture* tex = NULL;
+	vector<ATLAS_SHELF> shelves;
+	int next_y = ATLAS_PADDING;
+	SDL_Rect white = { 0 };
+	uint64 used_pixels = 0;
+};
+
+static vector<ATLAS_PAGE> pages;
+static bool atlas_failed = false;
+static uint64 atlas_sprites = 0, own_sprites = 0;
+
+// Width needed on a shelf for a sprite this wide, including the gap after it
+static int padded(int w) {
+	return w + ATLAS_PADDING;
+}
+
+static bool shelf_alloc(ATLAS_SHELF& shelf, int w, int h, SDL_Rect& rc) {
+	if (h > shelf.h || h < (shelf.h * 3) / 4 - 4) {
+		// don't waste a tall shelf on short sprites
+		return false;
+	}
+	for (auto x = shelf.free_spans.begin(); x != shelf.free_spans.end(); x++) {
+		if (x->w >= padded(w)) {
+			rc = { x->x, shelf.y, w, h };
+			x->x += padded(w);
+			x->w -= padded(w);
+			if (x->w == 0) {
+				shelf.free_spans.erase(x);
+			}
+			return true;
+		}
+	}
+	if (shelf.next_x + padded(w) <= ATLAS_PAGE_SIZE) {
+		rc = { shelf.next_x, shelf.y, w, h };
+		shelf.next_x += padded(w);
+		return true;
+	}
+	return false;
+}
+
+static bool page_alloc(ATLAS_PAGE& page, int w, int h, SDL_Rect& rc) {
+	for (auto& s : page.shelves) {
+		if (shelf_alloc(s, w, h, rc)) {
+			return true;
+		}
+	}
+	if (page.next_y + padded(h) > ATLAS_PAGE_SIZE) {
+		return false;
+	}
+	ATLAS_SHELF s;
+	s.y = page.next_y;
+	s.h = h;
+	page.next_y += padded(h);
+	page.shelves.push_back(s);
+	return shelf_alloc(page.shelves.back(), w, h, rc);
+}
+
+static void page_free(ATLAS_PAGE& page, const SDL_Rect& rc) {
+	for (auto s = page.shelves.begin(); s != page.shelves.end(); s++) {
+		if (s->y != rc.y) {
+			continue;
+		}
+
+		ATLAS_SPAN span = { rc.x, padded(rc.w) };
+		// keep the list sorted and merge with the neighbours
+		auto pos = s->free_spans.begin();
+		while (pos != s->free_spans.end() && pos->x < span.x) {
+			pos++;
+		}
+		pos = s->free_spans.insert(pos, span);
+		if (pos + 1 != s->free_spans.end() && pos->x + pos->w == (pos + 1)->x) {
+			pos->w += (pos + 1)->w;
+			s->free_spans.erase(pos + 1);
+		}
+		if (pos != s->free_spans.begin() && (pos - 1)->x + (pos - 1)->w == pos->x) {
+			(pos - 1)->w += pos->w;
+			pos = s->free_spans.erase(pos) - 1;
+		}
+		if (pos->x + pos->w == s->next_x) {
+			s->next_x = pos->x;
+			s->free_spans.erase(pos);
+		}
+		// an empty shelf at the bottom of the page gives its rows back
+		if (s->next_x == ATLAS_PADDING && s + 1 == page.shelves.end()) {
+			page.next_y = s->y;
+			page.shelves.erase(s);
+		}
+		return;
+	}
+}
+
+static bool upload(SDL_Texture* tex, const SDL_Rect& rc, SDL_Surface* src) {
+	// the spot might have been freed by a sprite that still has quads in the batch
+	batch_flush_texture(tex);
+	SDL_Surface* conv = src;
+	if (src->format->format != SDL_PIXELFORMAT_ARGB8888) {
+		conv = SDL_ConvertSurfaceFormat(src, SDL_PIXELFORMAT_ARGB8888, 0);
+		if (conv == NULL) {
+			return false;
+		}
+	}
+	bool ret = (SDL_UpdateTexture(tex, &rc, conv->pixels, conv->pitch) == 0);
+	if (conv != src) {
+		SDL_FreeSurface(conv);
+	}
+	return ret;
+}
+
+static ATLAS_PAGE* new_page() {
+	if (atlas_failed || pages.size() >= ATLAS_MAX_PAGES) {
+		return NULL;
+	}
+
+	ATLAS_PAGE page;
+	page.tex = texture_create(TO_ATLAS, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE);
+	if (page.tex == NULL) {
+		printf("Error creating atlas page, UI sprites will get their own textures: %s\n", SDL_GetError());
+		atlas_failed = true;
+		return NULL;
+	}
+	SDL_SetTextureBlendMode(page.tex, SDL_BLENDMODE_BLEND);
+	// sprites are drawn 1:1 or stretched from solid edges, filtering would only pull in the neighbours
+	SDL_SetTextureScaleMode(page.tex, SDL_ScaleModeNearest);
+
+	// static textures start out undefined
+	vector<uint32> clear(ATLAS_PAGE_SIZE * ATLAS_PAGE_SIZE, 0);
+	SDL_UpdateTexture(page.tex, NULL, clear.data(), ATLAS_PAGE_SIZE * sizeof(uint32));
+
+	vector<uint32> white(ATLAS_WHITE_SIZE * ATLAS_WHITE_SIZE, 0xFFFFFFFF);
+	if (!page_alloc(page, ATLAS_WHITE_SIZE, ATLAS_WHITE_SIZE, page.white) || SDL_UpdateTexture(page.tex, &page.white, white.data(), ATLAS_WHITE_SIZE * sizeof(uint32)) != 0) {
+		texture_destroy(page.tex);
+		atlas_failed = true;
+		return NULL;
+	}
+
+	pages.push_back(page);
+	return &pages.back();
+}
+
+static bool atlas_alloc(SDL_Surface* src, SPRITE& s) {
+	if (atlas_failed || src->w > ATLAS_MAX_SPRITE_W || src->h > ATLAS_MAX_SPRITE_H) {
+		return false;
+	}
+
+	for (size_t i = 0; i <= pages.size(); i++) {
+		ATLAS_PAGE* page = (i < pages.size()) ? &pages[i] : new_page();
+		if (page == NULL) {
+			return false;
+		}
+		SDL_Rect rc;
+		if (!page_alloc(*page, src->w, src->h, rc)) {
+			continue;
+		}
+		if (!upload(page->tex, rc, src)) {
+			page_free(*page, rc);
+			return false;
+		}
+		page->used_pixels += (uint64)rc.w * (uint64)rc.h;
+		s.tex = page->tex;
+		s.rc = rc;
+		s.tex_size = { ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE };
+		s.page = (int)i;
+		atlas_sprites++;
+		return true;
+	}
+	return false;
+}
+
+bool sprite_create(SDL_Surface* src, SPRITE& s, TEXTURE_OWNER owner, bool allow_atlas) {
+	sprite_free(s);
+	if (src == NULL) {
+		return false;
+	}
+	if (allow_atlas && atlas_alloc(src, s)) {
+		return true;
+	}
+
+	s.tex = texture_pool_acquire(owner, src->w, src->h, s.tex_size);
+	if (s.tex != NULL && !texture_pool_upload(s.tex, src)) {
+		texture_pool_release(s.tex);
+		s.tex = NULL;
+	}
+	if (s.tex == NULL) {
+		// no streaming textures on this renderer
+		s.tex = texture_create_from_surface(owner, src);
+		if (s.tex == NULL) {
+			return false;
+		}
+		SDL_SetTextureBlendMode(s.tex, SDL_BLENDMODE_BLEND);
+		s.tex_size = { src->w, src->h };
+	}
+	s.rc = { 0, 0, src->w, src->h };
+	s.page = -1;
+	own_sprites++;
+	return true;
+}
+
+void sprite_free(SPRITE& s) {
+	if (s.tex == NULL) {
+		return;
+	}
+	if (s.page < 0) {
+		if (!texture_pool_release(s.tex)) {
+			texture_destroy(s.tex);
+		}
+		own_sprites--;
+	} else if (s.page < (int)pages.size()) {
+		auto& page = pages[s.page];
+		page_free(page, s.rc);
+		page.used_pixels -= (uint64)s.rc.w * (uint64)s.rc.h;
+		atlas_sprites--;
+	}
+	s = SPRITE();
+}
+
+bool atlas_white(SDL_Texture* prefer, SDL_Texture*& tex, SDL_Rect& rc) {
+	if (pages.size() == 0) {
+		return false;
+	}
+	const ATLAS_PAGE* page = &pages[0];
+	for (auto& p : pages) {
+		if (p.tex == prefer) {
+			page = &p;
+			break;
+		}
+	}
+	tex = page->tex;
+	rc = page->white;
+	return true;
+}
+
+// Every sprite has to be freed before this
+void atlas_clear() {
+	for (auto& p : pages) {
+		texture_destroy(p.tex);
+	}
+	pages.clear();
+	atlas_sprites = 0;
+}
+
+string atlas_stats() {
+	uint64 used = 0;
+	for (auto& p : pages) {
+		used += p.used_pixels;
+	}
+	double per = pages.size() ? double(used) * 100.0 / (double(ATLAS_PAGE_SIZE) * double(ATLAS_PAGE_SIZE) * double(pages.size())) : 0.0;
+	return mprintf("Atlas: %zu pages of %dx%d, %llu sprites packed (%.1f%% full), %llu with their own texture", pages.size(), ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE, (unsigned long long)atlas_sprites, per, (unsigned long long)own_sprites);
+}
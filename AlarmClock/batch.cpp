@@ -0,0 +1,197 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2026 Drift Solutions
+
+#include "alarmclock.h"
+
+/*
+* Sprite and fill drawing for the UI. Between batch_begin() and batch_end() quads are queued and consecutive quads from
+* the same texture go out as one SDL_RenderGeometry() call, tinted with vertex colors so one atlas page covers every
+* color. Clipping is done on the quads themselves so it doesn't break up batches. Anything that draws with the renderer
+* directly, or changes the target/clip/viewport, has to call batch_flush() first so it lands in the right order.
+*/
+
+struct BATCH_QUAD {
+	SDL_FRect src; // texture pixels
+	SDL_FRect dest;
+	SDL_Color col;
+};
+
+static bool batching = false;
+static bool geometry_failed = false;
+static SDL_Texture* batch_tex = NULL;
+static SDL_Size batch_tex_size = { 0, 0 };
+static SDL_Texture* last_tex = NULL; // last texture drawn from this frame, for counting switches
+static vector<BATCH_QUAD> quads;
+static vector<SDL_Vertex> verts;
+static vector<int> indices;
+static BATCH_COUNTERS totals, last_frame, cur_frame;
+
+static void submit(SDL_Texture* tex, const SDL_Size& tex_size, const BATCH_QUAD* q, size_t num) {
+	if (num == 0) {
+		return;
+	}
+	if (tex != last_tex) {
+		cur_frame.texture_switches++;
+		last_tex = tex;
+	}
+
+	if (!geometry_failed) {
+		verts.resize(num * 4);
+		indices.resize(num * 6);
+		const float tw = (float)tex_size.w, th = (float)tex_size.h;
+		for (size_t i = 0; i < num; i++) {
+			const auto& d = q[i].dest;
+			const auto& s = q[i].src;
+			SDL_Vertex* v = &verts[i * 4];
+			v[0] = { { d.x, d.y }, q[i].col, { s.x / tw, s.y / th } };
+			v[1] = { { d.x + d.w, d.y }, q[i].col, { (s.x + s.w) / tw, s.y / th } };
+			v[2] = { { d.x, d.y + d.h }, q[i].col, { s.x / tw, (s.y + s.h) / th } };
+			v[3] = { { d.x + d.w, d.y + d.h }, q[i].col, { (s.x + s.w) / tw, (s.y + s.h) / th } };
+			int* ind = &indices[i * 6];
+			const int base = (int)(i * 4);
+			ind[0] = base; ind[1] = base + 1; ind[2] = base + 2;
+			ind[3] = base + 1; ind[4] = base + 3; ind[5] = base + 2;
+		}
+		if (SDL_RenderGeometry(config.mRenderer, tex, verts.data(), (int)verts.size(), indices.data(), (int)indices.size()) == 0) {
+			cur_frame.draw_calls++;
+			return;
+		}
+		printf("SDL_RenderGeometry() failed, drawing sprites with SDL_RenderCopy(): %s\n", SDL_GetError());
+		geometry_failed = true;
+	}
+
+	for (size_t i = 0; i < num; i++) {
+		SDL_SetTextureColorMod(tex, q[i].col.r, q[i].col.g, q[i].col.b);
+		SDL_SetTextureAlphaMod(tex, q[i].col.a);
+		SDL_Rect src = { (int)q[i].src.x, (int)q[i].src.y, (int)q[i].src.w, (int)q[i].src.h };
+		SDL_Rect dest = { (int)q[i].dest.x, (int)q[i].dest.y, (int)q[i].dest.w, (int)q[i].dest.h };
+		SDL_RenderCopy(config.mRenderer, tex, &src, &dest);
+		cur_frame.draw_calls++;
+	}
+}
+
+static void add_quad(SDL_Texture* tex, const SDL_Size& tex_size, BATCH_QUAD& q, const SDL_Rect* clip) {
+	if (clip != NULL) {
+		// trim the quad to the clip and the texture coordinates along with it
+		const float sx = q.src.w / q.dest.w, sy = q.src.h / q.dest.h;
+		const float x1 = max(q.dest.x, (float)clip->x), y1 = max(q.dest.y, (float)clip->y);
+		const float x2 = min(q.dest.x + q.dest.w, (float)(clip->x + clip->w)), y2 = min(q.dest.y + q.dest.h, (float)(clip->y + clip->h));
+		if (x2 <= x1 || y2 <= y1) {
+			return;
+		}
+		q.src.x += (x1 - q.dest.x) * sx;
+		q.src.y += (y1 - q.dest.y) * sy;
+		q.src.w = (x2 - x1) * sx;
+		q.src.h = (y2 - y1) * sy;
+		q.dest = { x1, y1, x2 - x1, y2 - y1 };
+	}
+	if (q.dest.w <= 0 || q.dest.h <= 0) {
+		return;
+	}
+	cur_frame.quads++;
+
+	if (!batching) {
+		texture_touch(tex);
+		submit(tex, tex_size, &q, 1);
+		return;
+	}
+	if (tex != batch_tex) {
+		batch_flush(false);
+		texture_touch(tex);
+		batch_tex = tex;
+		batch_tex_size = tex_size;
+	}
+	quads.push_back(q);
+}
+
+void draw_sprite(const SPRITE& s, const SDL_Rect& dest, const SDL_Color& col, const SDL_Rect* clip) {
+	draw_sprite_part(s, { 0, 0, s.rc.w, s.rc.h }, dest, col, clip);
+}
+
+void draw_sprite_part(const SPRITE& s, const SDL_Rect& src, const SDL_Rect& dest, const SDL_Color& col, const SDL_Rect* clip) {
+	if (s.tex == NULL || src.w <= 0 || src.h <= 0) {
+		return;
+	}
+	BATCH_QUAD q;
+	q.src = { (float)(s.rc.x + src.x), (float)(s.rc.y + src.y), (float)src.w, (float)src.h };
+	q.dest = { (float)dest.x, (float)dest.y, (float)dest.w, (float)dest.h };
+	q.col = col;
+	add_quad(s.tex, s.tex_size, q, clip);
+}
+
+void draw_fill(const SDL_Rect& rc, const SDL_Color& col) {
+	SDL_Texture* tex = NULL;
+	SDL_Rect white;
+	// the page being batched if it's an atlas page, so fills don't break up the batch
+	if (atlas_white(batch_tex, tex, white)) {
+		BATCH_QUAD q;
+		// sample the middle of the block so the edges never come into it
+		q.src = { (float)white.x + 1.0f, (float)white.y + 1.0f, (float)white.w - 2.0f, (float)white.h - 2.0f };
+		q.dest = { (float)rc.x, (float)rc.y, (float)rc.w, (float)rc.h };
+		q.col = col;
+		add_quad(tex, { ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE }, q, NULL);
+		return;
+	}
+
+	batch_flush();
+	SDL_SetRenderDrawBlendMode(config.mRenderer, SDL_BLENDMODE_BLEND);
+	SDL_SetRenderDrawColor(config.mRenderer, col);
+	SDL_RenderFillRect(config.mRenderer, &rc);
+	cur_frame.draw_calls++;
+}
+
+void draw_outline(const SDL_Rect& rc, const SDL_Color& col) {
+	// same pixels as SDL_RenderDrawRect()
+	draw_fill({ rc.x, rc.y, rc.w, 1 }, col);
+	draw_fill({ rc.x, rc.y + rc.h - 1, rc.w, 1 }, col);
+	draw_fill({ rc.x, rc.y + 1, 1, rc.h - 2 }, col);
+	draw_fill({ rc.x + rc.w - 1, rc.y + 1, 1, rc.h - 2 }, col);
+}
+
+void batch_begin() {
+	batching = true;
+	last_tex = NULL;
+}
+
+void batch_flush(bool forced) {
+	if (quads.size()) {
+		if (forced) {
+			cur_frame.forced_flushes++;
+		}
+		submit(batch_tex, batch_tex_size, quads.data(), quads.size());
+		quads.clear();
+	}
+	batch_tex = NULL;
+}
+
+void batch_flush_texture(SDL_Texture* tex) {
+	// earlier runs have already gone to SDL, which takes care of its own queue
+	if (quads.size() && tex == batch_tex) {
+		batch_flush(false);
+	}
+}
+
+void batch_end() {
+	batch_flush(false);
+	batching = false;
+
+	cur_frame.frames = 1;
+	last_frame = cur_frame;
+	totals.frames += cur_frame.frames;
+	totals.quads += cur_frame.quads;
+	totals.draw_calls += cur_frame.draw_calls;
+	totals.texture_switches += cur_frame.texture_switches;
+	totals.forced_flushes += cur_frame.forced_flushes;
+	cur_frame = BATCH_COUNTERS();
+}
+
+BATCH_COUNTERS batch_totals() {
+	return totals;
+}
+
+string batch_stats() {
+	const double frames = totals.frames ? double(totals.frames) : 1.0;
+	return mprintf("Batching: %llu frames, %.1f quads/frame in %.1f draw calls/frame, %.1f texture switches/frame, %.1f forced flushes/frame; last frame %llu quads, %llu draw calls, %llu texture switches",
+		(unsigned long long)totals.frames, double(totals.quads) / frames, double(totals.draw_calls) / frames, double(totals.texture_switches) / frames, double(totals.forced_flushes) / frames,
+		(unsigned long long)last_frame.quads, (unsigned long long)last_frame.draw_calls, (unsigned long long)last_frame.texture_switches);
+}
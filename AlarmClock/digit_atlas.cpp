@@ -0,0 +1,224 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2026 Drift Solutions
+
+#include "alarmclock.h"
+
+// Every character tm_to_str() can produce, in any time format
+const char* DigitAtlas::glyph_chars = "0123456789:ap";
+#define ATLAS_COLUMNS 5
+
+/*
+* Digits in our fonts are all the same width, so the size that fits a time string only depends on which characters are
+* digits and where the colons/suffix are. "12:34p" and "10:59p" both map to "00:00p".
+*/
+string DigitAtlas::Pattern(const string& str) {
+	string ret = str;
+	for (auto& c : ret) {
+		if (c >= '0' && c <= '9') {
+			c = '0';
+		}
+	}
+	return ret;
+}
+
+void DigitAtlas::setRect(const SDL_Rect& prc) {
+	if (memcmp(&rc, &prc, sizeof(SDL_Rect))) {
+		rc = prc;
+		// atlases themselves are still valid, but the sizes that fit might not be
+		fit_sizes.clear();
+		request_redraw();
+	}
+}
+
+void DigitAtlas::setText(const string& pstr) {
+	if (pstr != str) {
+		str = pstr;
+		request_redraw();
+	}
+}
+
+void DigitAtlas::setColor(const SDL_Color& pcol) {
+	if (memcmp(&col, &pcol, sizeof(SDL_Color))) {
+		col = pcol;
+		request_redraw();
+	}
+}
+
+int DigitAtlas::getFitSize(const string& pstr) {
+	string pattern = Pattern(pstr);
+	auto x = fit_sizes.find(pattern);
+	if (x != fit_sizes.end()) {
+		return x->second;
+	}
+
+	int ptSize = text_fit_size(pattern, font_size, { rc.w, rc.h }, TTF_STYLE_NORMAL, TFF_WIDTH | TFF_HEIGHT);
+	fit_sizes[pattern] = ptSize;
+	return ptSize;
+}
+
+// Renders every glyph into one surface, NULL if the font can't be opened
+SDL_Surface* DigitAtlas::renderGlyphs(int ptSize, ATLAS& atlas) {
+	auto font = GetFontSize(ptSize);
+	if (font == NULL) {
+		return NULL;
+	}
+
+	const SDL_Color white = { 0xFF, 0xFF, 0xFF, 0xFF };
+	SDL_Surface* glyphs[NUM_GLYPHS] = { NULL };
+	int cell_w = 0, cell_h = 0;
+	for (int i = 0; i < NUM_GLYPHS; i++) {
+		char buf[2] = { glyph_chars[i], 0 };
+		glyphs[i] = TTF_RenderUTF8_Blended(font, buf, white);
+		if (glyphs[i] != NULL) {
+			cell_w = max(cell_w, glyphs[i]->w);
+			cell_h = max(cell_h, glyphs[i]->h);
+		}
+	}
+
+	const int rows = (NUM_GLYPHS + ATLAS_COLUMNS - 1) / ATLAS_COLUMNS;
+	SDL_Surface* surface = (cell_w && cell_h) ? SDL_CreateRGBSurfaceWithFormat(0, cell_w * ATLAS_COLUMNS, cell_h * rows, 32, SDL_PIXELFORMAT_RGBA32) : NULL;
+	if (surface != NULL) {
+		for (int i = 0; i < NUM_GLYPHS; i++) {
+			if (glyphs[i] == NULL) {
+				continue;
+			}
+			SDL_Rect dest = { (i % ATLAS_COLUMNS) * cell_w, (i / ATLAS_COLUMNS) * cell_h, glyphs[i]->w, glyphs[i]->h };
+			// straight copy including alpha, the atlas starts out fully transparent
+			SDL_SetSurfaceBlendMode(glyphs[i], SDL_BLENDMODE_NONE);
+			SDL_BlitSurface(glyphs[i], NULL, surface, &dest);
+			atlas.glyphs[i] = dest;
+		}
+		atlas.height = cell_h;
+	}
+	for (auto& g : glyphs) {
+		if (g != NULL) {
+			SDL_FreeSurface(g);
+		}
+	}
+	return surface;
+}
+
+DigitAtlas::ATLAS* DigitAtlas::getAtlas(int ptSize) {
+	auto x = atlases.find(ptSize);
+	if (x != atlases.end()) {
+		texture_touch(x->second.spr.tex);
+		return &x->second;
+	}
+
+	ATLAS atlas;
+	// the glyph rects and height ride along with the pixels
+	const string cache_key = mprintf("digits:%d", ptSize);
+	string extra;
+	SDL_Surface* surface = raster_cache_get(cache_key, &extra);
+	if (surface != NULL && extra.length() == sizeof(atlas.glyphs) + sizeof(atlas.height)) {
+		memcpy(atlas.glyphs, extra.data(), sizeof(atlas.glyphs));
+		memcpy(&atlas.height, extra.data() + sizeof(atlas.glyphs), sizeof(atlas.height));
+	} else {
+		if (surface != NULL) {
+			SDL_FreeSurface(surface);
+		}
+		surface = renderGlyphs(ptSize, atlas);
+		if (surface != NULL) {
+			extra.assign((const char*)atlas.glyphs, sizeof(atlas.glyphs));
+			extra.append((const char*)&atlas.height, sizeof(atlas.height));
+			raster_cache_put(cache_key, surface, extra);
+		}
+	}
+	if (surface != NULL) {
+		// small sizes (the flip clock's) get packed into a shared page
+		sprite_create(surface, atlas.spr, TO_GLYPHS);
+		SDL_FreeSurface(surface);
+	}
+
+	if (atlas.spr.tex == NULL) {
+		printf("Error creating digit atlas for point size %d: %s\n", ptSize, SDL_GetError());
+		return NULL;
+	}
+	if (atlas.spr.page < 0) {
+		texture_set_evict(atlas.spr.tex, [this, ptSize]() {
+			auto x = atlases.find(ptSize);
+			if (x != atlases.end()) {
+				sprite_free(x->second.spr);
+				atlases.erase(x);
+			}
+		});
+	}
+
+	return &(atlases[ptSize] = atlas);
+}
+
+// Finds the atlas for the current string and where its first glyph goes
+DigitAtlas::ATLAS* DigitAtlas::layout(SDL_Rect& bounds) {
+	if (str.empty()) {
+		return NULL;
+	}
+
+	auto atlas = getAtlas(getFitSize(str));
+	if (atlas == NULL) {
+		return NULL;
+	}
+
+	int total_w = 0;
+	for (auto c : str) {
+		auto p = strchr(glyph_chars, c);
+		if (p != NULL && c != 0) {
+			total_w += atlas->glyphs[p - glyph_chars].w;
+		}
+	}
+
+	int x = rc.x;
+	if (align & DTA_RIGHT) {
+		x = rc.x + rc.w - total_w;
+	} else if (align & DTA_CENTER) {
+		x = rc.x + ((rc.w - total_w) / 2);
+	}
+	int y = rc.y;
+	if (align & DTA_MIDDLE) {
+		y += (rc.h - atlas->height) / 2;
+	} else if (align & DTA_BOTTOM) {
+		y += rc.h - atlas->height - 1;
+	}
+
+	bounds = { x, y, total_w, atlas->height };
+	return atlas;
+}
+
+void DigitAtlas::GetState(string& state) {
+	state += mprintf("%d,%d,%d,%d|%02x%02x%02x%02x|%d,%d|", rc.x, rc.y, rc.w, rc.h, col.r, col.g, col.b, col.a, font_size, align);
+	state += str;
+	state += '\0';
+}
+
+SDL_Rect DigitAtlas::GetBounds() {
+	SDL_Rect ret = { 0, 0, 0, 0 };
+	layout(ret);
+	return ret;
+}
+
+void DigitAtlas::Draw() {
+	SDL_Rect bounds;
+	auto atlas = layout(bounds);
+	if (atlas == NULL) {
+		return;
+	}
+
+	int x = bounds.x;
+	for (auto c : str) {
+		auto p = strchr(glyph_chars, c);
+		if (p == NULL || c == 0) {
+			continue;
+		}
+		const SDL_Rect& src = atlas->glyphs[p - glyph_chars];
+		SDL_Rect dest = { x, bounds.y, src.w, src.h };
+		draw_sprite_part(atlas->spr, src, dest, col);
+		x += src.w;
+	}
+}
+
+void DigitAtlas::Reset() {
+	for (auto& a : atlases) {
+		sprite_free(a.second.spr);
+	}
+	atlases.clear();
+	fit_sizes.clear();
+}
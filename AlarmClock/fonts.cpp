@@ -0,0 +1,174 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2026 Drift Solutions
+
+#include "alarmclock.h"
+#ifndef WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/*
+* Faces are opened off the render thread too (see prewarm.cpp). SDL_ttf shares one FreeType library between all of them,
+* which isn't safe to open or close faces in from more than one thread at once.
+*/
+static DSL_Mutex fontMutex;
+static FontFile font_regular("resources/roboto.ttf");
+static FontFile font_mono("resources/roboto_mono.ttf");
+
+bool FontFile::Load() {
+	if (data != NULL) {
+		return true;
+	}
+	if (load_failed) {
+		// don't hit the disk again for every size we're asked for
+		return false;
+	}
+
+	if (resource_pack_find(fn, data, data_len)) {
+		packed = true;
+		printf("Loaded font %s (%zu KB, packed)\n", fn.c_str(), data_len / 1024);
+		return true;
+	}
+
+#ifndef WIN32
+	int fd = open(fn.c_str(), O_RDONLY);
+	if (fd != -1) {
+		struct stat st;
+		if (fstat(fd, &st) == 0 && st.st_size > 0) {
+			void* p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (p != MAP_FAILED) {
+				data = (const uint8*)p;
+				data_len = st.st_size;
+				mapped = true;
+			}
+		}
+		close(fd);
+	}
+#endif
+
+	if (data == NULL) {
+		// no mmap on this platform or it failed, just keep a copy in memory
+		if (!file_get_contents(fn, buf) || buf.empty()) {
+			printf("Error loading font %s\n", fn.c_str());
+			load_failed = true;
+			return false;
+		}
+		data = (const uint8*)buf.data();
+		data_len = buf.length();
+	}
+
+	printf("Loaded font %s (%zu KB, %s)\n", fn.c_str(), data_len / 1024, mapped ? "mapped" : "in memory");
+	return true;
+}
+
+TTF_Font* FontFile::openSize(int ptSize) {
+	if (!Load()) {
+		return NULL;
+	}
+
+	// the RWops only wraps our copy, SDL_ttf frees it when the font is closed
+	auto font = TTF_OpenFontRW(SDL_RWFromConstMem(data, (int)data_len), 1, ptSize);
+	if (font == NULL) {
+		printf("Error opening font with point size %d: %s\n", ptSize, TTF_GetError());
+	}
+	return font;
+}
+
+TTF_Font* FontFile::GetSize(int ptSize) {
+	AutoMutex(fontMutex);
+	auto x = sizes.find(ptSize);
+	if (x != sizes.end()) {
+		return x->second;
+	}
+
+	auto font = openSize(ptSize);
+	if (font != NULL) {
+		sizes[ptSize] = font;
+	}
+	return font;
+}
+
+TTF_Font* FontFile::OpenPrivate(int ptSize) {
+	AutoMutex(fontMutex);
+	return openSize(ptSize);
+}
+
+uint64 FontFile::Hash(uint64 h) {
+	AutoMutex(fontMutex);
+	if (!Load()) {
+		return h;
+	}
+	return hash_bytes(h, data, data_len);
+}
+
+string FontFile::Stats() {
+	AutoMutex(fontMutex);
+	string ret = mprintf("%s: %zu KB %s, %zu sizes open", fn.c_str(), data_len / 1024, packed ? "packed" : (mapped ? "mapped" : "in memory"), sizes.size());
+	if (sizes.size()) {
+		ret += " (";
+		bool first = true;
+		for (auto& x : sizes) {
+			if (!first) {
+				ret += ", ";
+			}
+			ret += mprintf("%d", x.first);
+			first = false;
+		}
+		ret += ")";
+	}
+	return ret;
+}
+
+void FontFile::Reset() {
+	AutoMutex(fontMutex);
+	// every face has to be closed before the memory they read from goes away
+	for (auto& x : sizes) {
+		TTF_CloseFont(x.second);
+	}
+	sizes.clear();
+
+#ifndef WIN32
+	if (mapped) {
+		munmap((void*)data, data_len);
+	}
+#endif
+	mapped = false;
+	packed = false;
+	data = NULL;
+	data_len = 0;
+	buf.clear();
+	buf.shrink_to_fit();
+	load_failed = false;
+}
+
+TTF_Font* GetFontSize(int ptSize) {
+	return font_regular.GetSize(ptSize);
+}
+
+TTF_Font* GetMonoFontSize(int ptSize) {
+	return font_mono.GetSize(ptSize);
+}
+
+TTF_Font* OpenPrivateFontSize(int ptSize) {
+	return font_regular.OpenPrivate(ptSize);
+}
+
+void ClosePrivateFont(TTF_Font* font) {
+	AutoMutex(fontMutex);
+	TTF_CloseFont(font);
+}
+
+void close_fonts() {
+	font_regular.Reset();
+	font_mono.Reset();
+}
+
+uint64 font_files_hash(uint64 h) {
+	return font_mono.Hash(font_regular.Hash(h));
+}
+
+string font_stats() {
+	return font_regular.Stats() + "\n" + font_mono.Stats();
+}
@@ -0,0 +1,160 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2026 Drift Solutions
+
+#include "alarmclock.h"
+
+/*
+* Buckets are log-linear: values under 16us get their own bucket, after that every power of two is split into 4 sub-buckets.
+* That keeps the error under 25% from 16us up to ~67 seconds with a fixed 104 counters per phase.
+*/
+
+static int bucket_for_value(uint64 us) {
+	if (us < 16) {
+		return (int)us;
+	}
+	int octave = 0;
+	for (uint64 tmp = us; tmp > 1; tmp >>= 1) {
+		octave++;
+	}
+	int sub = (int)((us >> (octave - 2)) & 3);
+	int ret = 16 + ((octave - 4) * 4) + sub;
+	return min(ret, FrameHistogram::NUM_BUCKETS - 1);
+}
+
+static uint64 bucket_upper_bound(int bucket) {
+	if (bucket < 16) {
+		return (uint64)bucket;
+	}
+	int octave = ((bucket - 16) / 4) + 4;
+	int sub = (bucket - 16) % 4;
+	return ((uint64)(4 + sub + 1) << (octave - 2)) - 1;
+}
+
+void FrameHistogram::Add(uint64 us) {
+	buckets[bucket_for_value(us)]++;
+	count++;
+	total_us += us;
+	if (us > max_us) {
+		max_us = us;
+	}
+}
+
+uint64 FrameHistogram::Percentile(double p) const {
+	if (count == 0) {
+		return 0;
+	}
+	uint64 target = (uint64)ceil(double(count) * p / 100.0);
+	if (target == 0) {
+		target = 1;
+	}
+	uint64 seen = 0;
+	for (int i = 0; i < NUM_BUCKETS; i++) {
+		seen += buckets[i];
+		if (seen >= target) {
+			return min(bucket_upper_bound(i), max_us);
+		}
+	}
+	return max_us;
+}
+
+void FrameHistogram::Reset() {
+	memset(buckets, 0, sizeof(buckets));
+	count = total_us = max_us = 0;
+}
+
+// the logic thread adds to these too
+static DSL_Mutex statsMutex;
+static FrameHistogram phase_stats[FP_NUM_PHASES];
+static const char* phase_names[FP_NUM_PHASES] = {
+	"alarm_loop",
+	"tick_30s",
+	"home_assistant",
+	"logic",
+	"alarm_latency",
+	"events",
+	"input_latency",
+	"page_tick",
+	"page_render",
+	"present",
+	"frame",
+};
+static time_t stats_start = time(NULL);
+
+Uint64 FrameTimer::Now() {
+	return SDL_GetPerformanceCounter();
+}
+
+void FrameTimer::Stop() {
+	if (!stopped) {
+		frame_stats_add(phase, FrameTimer::Now() - start);
+		stopped = true;
+	}
+}
+
+void frame_stats_add(FRAME_PHASES phase, Uint64 perf_ticks) {
+	static const Uint64 perf_freq = SDL_GetPerformanceFrequency();
+	frame_stats_add_us(phase, perf_ticks * 1000000 / perf_freq);
+}
+
+void frame_stats_add_us(FRAME_PHASES phase, uint64 us) {
+	AutoMutex(statsMutex);
+	phase_stats[phase].Add(us);
+}
+
+FrameHistogram frame_stats_get(FRAME_PHASES phase) {
+	AutoMutex(statsMutex);
+	return phase_stats[phase];
+}
+
+static string us_to_ms(uint64 us) {
+	return mprintf("%.1f", double(us) / 1000.0);
+}
+
+// Once a second on the main thread's timers
+void frame_stats_update_readout() {
+	FrameHistogram h;
+	{
+		AutoMutex(statsMutex);
+		h = phase_stats[FP_FRAME];
+	}
+	statusbar_set(SB_FRAME_STATS, mprintf("Frame ms: %s/%s/%s/%s", us_to_ms(h.Percentile(50)).c_str(), us_to_ms(h.Percentile(95)).c_str(), us_to_ms(h.Percentile(99)).c_str(), us_to_ms(h.max_us).c_str()));
+}
+
+bool frame_stats_dump() {
+	stringstream sstr;
+	sstr << "Frame timing since " << ts_to_str(stats_start) << " (" << FormatMinutes(time(NULL) - stats_start) << "), all values in ms" << endl;
+	sstr << "Rendered frames: " << config.cur_frame << endl;
+	sstr << "First clock frame: " << config.first_clock_frame_ms << " ms after start" << endl;
+	sstr << raster_cache_stats() << endl;
+	sstr << resource_pack_stats() << endl;
+	sstr << text_cache_stats() << endl;
+	sstr << text_fit_stats() << endl;
+	sstr << text_async_stats() << endl;
+	sstr << shape_cache_stats() << endl;
+	sstr << atlas_stats() << endl;
+	sstr << image_cache_stats() << endl;
+	sstr << batch_stats() << endl;
+	sstr << texture_stats() << endl;
+	sstr << texture_pool_stats() << endl;
+	sstr << scene_stats() << endl;
+	sstr << "Main thread timers: " << config.timers.Stats() << endl;
+	sstr << font_stats() << endl << endl;
+	sstr << mprintf("%-16s %10s %10s %10s %10s %10s %10s", "Phase", "Count", "Mean", "p50", "p95", "p99", "Max") << endl;
+	for (int i = 0; i < FP_NUM_PHASES; i++) {
+		FrameHistogram h;
+		{
+			AutoMutex(statsMutex);
+			h = phase_stats[i];
+		}
+		uint64 mean = h.count ? h.total_us / h.count : 0;
+		sstr << mprintf("%-16s %10llu %10s %10s %10s %10s %10s", phase_names[i], (unsigned long long)h.count, us_to_ms(mean).c_str(), us_to_ms(h.Percentile(50)).c_str(), us_to_ms(h.Percentile(95)).c_str(), us_to_ms(h.Percentile(99)).c_str(), us_to_ms(h.max_us).c_str()) << endl;
+	}
+
+	string fn = cfg->GetDataDirFile("frame_stats.txt");
+	if (!file_put_contents(fn, sstr.str())) {
+		printf("Error writing frame stats to %s\n", fn.c_str());
+		return false;
+	}
+	printf("Wrote frame stats to %s\n", fn.c_str());
+	return true;
+}
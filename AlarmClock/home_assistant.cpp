@@ -284,17 +284,23 @@ DSL_DEFINE_THREAD(HomeAssistantUpdateInfoThread) {
 	bool last_sent_alarming = false;
 	bool last_sent_alarm_enabled = false;
 	time_t last_sent_next_alarm = 0;
-	int64 last_sent = 0;
 
-	int64 last_update = 0;
+	// everything is sent again every 10 minutes, and fetched every 30 seconds
+	TimerWheel timers;
+	bool do_scheduled_send = true, do_fetch = true;
+	timers.Add(600000, [&do_scheduled_send]() { do_scheduled_send = true; }, 600000);
+	timers.Add(30000, [&do_fetch]() { do_fetch = true; }, 30000);
+
 	while (!config.shutdown_now) {
+		timers.Run();
 		if (send_updates) {
-			bool do_scheduled_send = (time(NULL) - last_sent >= 600);
+			// what the logic thread last published, reading config.alarming/options from here would race it
+			auto ui = ui_state_get();
 			bool had_error = false;
 			bool did_send = false;
 
-			if (!config.home_assistant.alarm_entity.empty() && (config.alarming != last_sent_alarming || do_scheduled_send)) {
-				bool tmp = config.alarming;
+			if (!config.home_assistant.alarm_entity.empty() && (ui->alarming != last_sent_alarming || do_scheduled_send)) {
+				bool tmp = ui->alarming;
 				if (cli->UpdateStateStr(config.home_assistant.alarm_entity, tmp ? "on" : "off")) {
 					printf("Sent Home Assistant new alarm status: %s\n", tmp ? "on" : "off");
 					last_sent_alarming = tmp;
@@ -305,8 +311,8 @@ DSL_DEFINE_THREAD(HomeAssistantUpdateInfoThread) {
 					had_error = true;
 				}
 			}
-			if (!config.home_assistant.alarm_enabled_entity.empty() && (config.options.enable_alarm != last_sent_alarm_enabled || do_scheduled_send)) {
-				bool tmp = config.options.enable_alarm;
+			if (!config.home_assistant.alarm_enabled_entity.empty() && (ui->enable_alarm != last_sent_alarm_enabled || do_scheduled_send)) {
+				bool tmp = ui->enable_alarm;
 				if (cli->UpdateStateStr(config.home_assistant.alarm_enabled_entity, tmp ? "on" : "off")) {
 					printf("Sent Home Assistant new alarm enabled status: %s\n", tmp ? "on" : "off");
 					last_sent_alarm_enabled = tmp;
@@ -319,7 +325,7 @@ DSL_DEFINE_THREAD(HomeAssistantUpdateInfoThread) {
 			}
 
 			if (!config.home_assistant.next_alarm_entity.empty()) {
-				time_t next_alarm = config.options.GetNextAlarmTime();
+				time_t next_alarm = ui->next_alarm;
 				if (next_alarm != last_sent_next_alarm || do_scheduled_send) {
 					char buf[128];
 					struct tm tm;
@@ -339,24 +345,27 @@ DSL_DEFINE_THREAD(HomeAssistantUpdateInfoThread) {
 
 			if (did_send && !had_error) {
 				statusbar_set(SB_HOME_ASSISTANT_SEND, mprintf("HA: Sent %s", ts_to_str(time(NULL)).c_str()));
-				last_sent = time(NULL);
+				do_scheduled_send = false;
 			}
 		}
 
-		if (time(NULL) - last_update >= 30) {
+		if (do_fetch) {
+			do_fetch = false;
 			Home_Assistant_Info info;
 			if (cli->GetEntities(info) && info.running) {
 				statusbar_set(SB_HOME_ASSISTANT_RECV, mprintf("HA: Updated %s", ts_to_str(time(NULL)).c_str()));
 				AutoMutex(infoMutex);
 				::info = std::move(info);
 				ha_had_update = true;
+				// wake the logic thread so it merges the new snapshot
+				logic_wake();
 			} else {
 				statusbar_set(SB_HOME_ASSISTANT_RECV, mprintf("HA Error: %s", cli->error.c_str()));
 			}
-			last_update = time(NULL);
 		}
 
-		safe_sleep(1);
+		// changes to the published state are only noticed by looking, so no more than a second
+		safe_sleep(timers.TimeoutMs(1000), true);
 	}
 
 	delete cli;
@@ -0,0 +1,204 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2026 Drift Solutions
+
+#include "alarmclock.h"
+
+/*
+* Menu icons, shared by every MenuItem. Everything in resources/images is loaded once (straight out of the resource pack
+* when there is one) and packed into one texture, so building and opening menus never decodes a PNG and a page of icon
+* buttons goes out in one batch. Icons don't go on the shared atlas pages: they're big and drawn scaled with linear
+* filtering, which needs a wider gap around them than text does. An icon that wasn't there when the atlas was made gets
+* a texture of its own the first time it's asked for.
+*/
+
+#define ICON_ATLAS_WIDTH 1024
+#define ICON_PADDING 2 // linear filtering reads a texel past the edge
+#define ICON_RETRY_INTERVAL 10000 // ms before trying an icon that failed to load again
+
+struct ICON {
+	SPRITE spr; // in icon_atlas or, if own is set, a texture of its own
+	bool own = false;
+	Uint64 failed = 0; // when it last failed to load
+};
+
+static map<string, ICON> icons; // by file name in resources/images
+static SDL_Texture* icon_atlas = NULL;
+static bool atlas_built = false;
+static uint64 icon_hits = 0, icon_loads = 0;
+
+static const SDL_Color icon_white = { 0xFF, 0xFF, 0xFF, 0xFF };
+
+static SDL_Texture* create_icon_texture(SDL_Surface* src) {
+	// icons are always drawn scaled
+	SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "1");
+	SDL_Texture* tex = texture_create_from_surface(TO_IMAGES, src);
+	if (tex != NULL) {
+		SDL_SetTextureBlendMode(tex, SDL_BLENDMODE_BLEND);
+	}
+	return tex;
+}
+
+// Frees the atlas and every icon in it, they're packed again the next time one is needed
+static void free_atlas() {
+	for (auto x = icons.begin(); x != icons.end();) {
+		if (!x->second.own && x->second.spr.tex != NULL) {
+			x = icons.erase(x);
+		} else {
+			x++;
+		}
+	}
+	texture_destroy(icon_atlas);
+	icon_atlas = NULL;
+	atlas_built = false;
+}
+
+void image_cache_load() {
+	if (atlas_built) {
+		return;
+	}
+	atlas_built = true;
+	Uint64 start = SDL_GetTicks64();
+
+	vector<string> files;
+	resource_list("resources/images", files);
+	vector<pair<string, SDL_Surface*>> loaded;
+	for (auto& fn : files) {
+		string name = fn.substr(fn.find_last_of('/') + 1);
+		if (icons.count(name)) {
+			// already has a texture of its own
+			continue;
+		}
+		auto src = resource_load_image(fn);
+		if (src != NULL) {
+			loaded.push_back({ name, src });
+			icon_loads++;
+		}
+	}
+	if (loaded.empty()) {
+		return;
+	}
+
+	// shelves, tallest first
+	sort(loaded.begin(), loaded.end(), [](const pair<string, SDL_Surface*>& a, const pair<string, SDL_Surface*>& b) { return a.second->h > b.second->h; });
+	int w = ICON_ATLAS_WIDTH;
+	for (auto& x : loaded) {
+		w = max(w, x.second->w + (ICON_PADDING * 2));
+	}
+	vector<SDL_Rect> rcs;
+	int x = ICON_PADDING, y = ICON_PADDING, shelf_h = 0;
+	for (auto& l : loaded) {
+		if (x + l.second->w + ICON_PADDING > w) {
+			x = ICON_PADDING;
+			y += shelf_h + ICON_PADDING;
+			shelf_h = 0;
+		}
+		rcs.push_back({ x, y, l.second->w, l.second->h });
+		x += l.second->w + ICON_PADDING;
+		shelf_h = max(shelf_h, l.second->h);
+	}
+	const int h = y + shelf_h + ICON_PADDING;
+
+	SDL_RendererInfo info;
+	bool fits = (SDL_GetRendererInfo(config.mRenderer, &info) == 0 && (info.max_texture_width == 0 || (w <= info.max_texture_width && h <= info.max_texture_height)));
+	SDL_Surface* surface = fits ? SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_ARGB8888) : NULL;
+	if (surface != NULL) {
+		for (size_t i = 0; i < loaded.size(); i++) {
+			// copy the alpha instead of blending onto the empty surface
+			SDL_SetSurfaceBlendMode(loaded[i].second, SDL_BLENDMODE_NONE);
+			SDL_BlitSurface(loaded[i].second, NULL, surface, &rcs[i]);
+		}
+		icon_atlas = create_icon_texture(surface);
+		SDL_FreeSurface(surface);
+	}
+
+	if (icon_atlas != NULL) {
+		for (size_t i = 0; i < loaded.size(); i++) {
+			auto& icon = icons[loaded[i].first];
+			icon.spr.tex = icon_atlas;
+			icon.spr.rc = rcs[i];
+			icon.spr.tex_size = { w, h };
+			icon.spr.page = -1;
+		}
+		texture_set_evict(icon_atlas, free_atlas);
+		printf("Packed %zu icons into a %dx%d texture in %llums\n", loaded.size(), w, h, (unsigned long long)(SDL_GetTicks64() - start));
+	} else {
+		printf("Error making the icon atlas, icons will get textures of their own: %s\n", SDL_GetError());
+	}
+
+	for (auto& l : loaded) {
+		SDL_FreeSurface(l.second);
+	}
+}
+
+static void free_own_icon(const string& name) {
+	auto x = icons.find(name);
+	if (x != icons.end()) {
+		texture_destroy(x->second.spr.tex);
+		icons.erase(x);
+	}
+}
+
+const SPRITE* image_cache_get(const string& image) {
+	image_cache_load();
+
+	auto& icon = icons[image];
+	if (icon.spr.tex != NULL) {
+		texture_touch(icon.spr.tex);
+		icon_hits++;
+		return &icon.spr;
+	}
+	if (icon.failed != 0 && SDL_GetTicks64() - icon.failed < ICON_RETRY_INTERVAL) {
+		return NULL;
+	}
+
+	auto src = resource_load_image("resources/images/" + image);
+	if (src != NULL) {
+		icon_loads++;
+		icon.spr.tex = create_icon_texture(src);
+		if (icon.spr.tex != NULL) {
+			icon.spr.rc = { 0, 0, src->w, src->h };
+			icon.spr.tex_size = { src->w, src->h };
+			icon.spr.page = -1;
+			icon.own = true;
+			icon.failed = 0;
+			texture_set_evict(icon.spr.tex, [image]() { free_own_icon(image); });
+		}
+		SDL_FreeSurface(src);
+	}
+	if (icon.spr.tex == NULL) {
+		printf("Error loading image %s\n", image.c_str());
+		icon.failed = SDL_GetTicks64();
+		return NULL;
+	}
+	return &icon.spr;
+}
+
+void image_cache_draw(const SPRITE& icon, const SDL_Rect& container) {
+	SDL_Rect src = { 0, 0, icon.rc.w, icon.rc.h };
+	draw_sprite(icon, ScaleRectToFit(src, container), icon_white);
+}
+
+void image_cache_clear() {
+	for (auto& x : icons) {
+		if (x.second.own) {
+			texture_destroy(x.second.spr.tex);
+		}
+	}
+	icons.clear();
+	texture_destroy(icon_atlas);
+	icon_atlas = NULL;
+	atlas_built = false;
+}
+
+string image_cache_stats() {
+	size_t num = 0, own = 0;
+	for (auto& x : icons) {
+		if (x.second.spr.tex != NULL) {
+			num++;
+			if (x.second.own) {
+				own++;
+			}
+		}
+	}
+	return mprintf("Icons: %zu cached (%zu with their own texture), %llu loaded, %llu hits", num, own, (unsigned long long)icon_loads, (unsigned long long)icon_hits);
+}
@@ -58,7 +58,7 @@ void update_lcd_brightness() {
     static uint8 bright_level = (uint8)max((int64)0, min((int64)255, cfg->GetIntArg("-lcd_bright_level", 255)));
     static uint8 dim_level = (uint8)max((int64)0, min((int64)255, cfg->GetIntArg("-lcd_dim_level", 50)));
 
-    if (config.is_dark && config.options.dim_when_dark) {
+    if (config.is_dark && logic_options().dim_when_dark) {
         config.set_lcd_brightness(dim_level);
     } else {
         config.set_lcd_brightness(bright_level);
@@ -0,0 +1,188 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2026 Drift Solutions
+
+#include "alarmclock.h"
+
+/*
+* The alarm checks, the alarm sound, the light/dark check and merging Home Assistant updates run on their own thread
+* instead of the main loop, so a slow frame can't hold up an alarm and a blocking fallback player (aplay) can't freeze
+* the screen. SDL wants the window, renderer and event queue on the main thread, so drawing and input stay there.
+*
+* Neither side writes anything the other one reads:
+* - The UI owns config.options. Every change goes through save_dynamic_settings(), which hands this thread a copy.
+* - This thread owns config.alarming, config.is_dark and config.home_assistant.info. After every pass it publishes what
+*   the UI needs as a UI_STATE that's never changed again, and the main loop swaps its copy (config.ui) for the latest
+*   one at the top of every iteration, so a frame is always drawn from one consistent state.
+* - Anything else one side needs done on the other goes through logic_post() / main_post().
+*/
+
+static DSL_Mutex logicMutex;
+static SDL_sem* logic_sem = NULL;
+static SDL_threadID logic_thread = 0;
+static vector<function<void()>> logic_tasks, main_tasks;
+static shared_ptr<const UI_STATE> published = make_shared<UI_STATE>();
+static uint64 generation = 0;
+static ConfigOptions options; // this thread's copy of config.options
+static TimerWheel timers;
+
+bool on_logic_thread() {
+	return logic_thread != 0 && SDL_ThreadID() == logic_thread;
+}
+
+ConfigOptions& logic_options() {
+	return options;
+}
+
+void logic_wake() {
+	if (logic_sem != NULL && SDL_SemValue(logic_sem) == 0) {
+		SDL_SemPost(logic_sem);
+	}
+}
+
+void logic_post(function<void()> fn) {
+	{
+		AutoMutex(logicMutex);
+		logic_tasks.push_back(fn);
+	}
+	logic_wake();
+}
+
+void logic_schedule_wakeup(Uint64 ms) {
+	timers.WakeWithin(ms);
+}
+
+void logic_set_options(const ConfigOptions& opts) {
+	logic_post([opts]() {
+		options = opts;
+		alarm_schedule_changed();
+		// dim_when_dark might be what changed
+		update_lcd_brightness();
+	});
+}
+
+void main_post(function<void()> fn) {
+	{
+		AutoMutex(logicMutex);
+		main_tasks.push_back(fn);
+	}
+	// everything posted to the main thread changes what's on screen anyway
+	request_redraw();
+}
+
+void main_run_posted() {
+	vector<function<void()>> tasks;
+	{
+		AutoMutex(logicMutex);
+		tasks.swap(main_tasks);
+	}
+	for (auto& fn : tasks) {
+		fn();
+	}
+}
+
+static void run_logic_posted() {
+	vector<function<void()>> tasks;
+	{
+		AutoMutex(logicMutex);
+		tasks.swap(logic_tasks);
+	}
+	for (auto& fn : tasks) {
+		fn();
+	}
+}
+
+static bool same_state(const UI_STATE& a, const UI_STATE& b) {
+	return a.alarming == b.alarming && a.is_dark == b.is_dark && a.enable_alarm == b.enable_alarm && a.next_alarm == b.next_alarm
+		&& a.ha.last_update == b.ha.last_update && a.ha.is_dark == b.ha.is_dark && a.ha.weather == b.ha.weather && a.ha.temp == b.ha.temp && a.ha.temp_unit == b.ha.temp_unit;
+}
+
+static void publish() {
+	auto s = make_shared<UI_STATE>();
+	s->alarming = config.alarming;
+	s->is_dark = config.is_dark;
+	s->enable_alarm = options.enable_alarm;
+	s->next_alarm = alarm_next_due();
+	s->ha = config.home_assistant.info;
+
+	{
+		AutoMutex(logicMutex);
+		if (same_state(*published, *s)) {
+			return;
+		}
+		s->generation = ++generation;
+		published = s;
+	}
+	request_redraw();
+}
+
+shared_ptr<const UI_STATE> ui_state_get() {
+	AutoMutex(logicMutex);
+	return published;
+}
+
+void ui_state_update() {
+	auto s = ui_state_get();
+	if (s == config.ui) {
+		return;
+	}
+	auto prev = config.ui;
+	config.ui = s;
+	if (prev->is_dark != s->is_dark && config.cur_page) {
+		config.cur_page->OnDarkChanged();
+	}
+	config.needs_redraw = true;
+}
+
+DSL_DEFINE_THREAD(LogicThread) {
+	DSL_THREAD_START
+	logic_thread = SDL_ThreadID();
+
+	auto run_tick_30s = []() {
+		FrameTimer t(FP_TICK_30S);
+		tick_30s();
+	};
+	run_tick_30s();
+	timers.Add(30000, run_tick_30s, 30000);
+
+	while (!config.shutdown_now) {
+		FrameTimer timer(FP_LOGIC);
+		run_logic_posted();
+		timers.Run();
+		{
+			FrameTimer t(FP_ALARM_LOOP);
+			alarm_loop();
+		}
+		if (config.home_assistant.isValid()) {
+			FrameTimer t(FP_HOME_ASSISTANT);
+			update_home_assistant();
+		}
+		publish();
+		timer.Stop();
+
+		// shutdown() wakes us up, so this can sleep until the next timer
+		SDL_SemWaitTimeout(logic_sem, timers.TimeoutMs(60000));
+	}
+
+	logic_thread = 0;
+	DSL_THREAD_END
+}
+
+void start_logic_thread() {
+	options = config.options;
+	logic_sem = SDL_CreateSemaphore(0);
+	// so the first frame already has the real state
+	publish();
+	ui_state_update();
+	DSL_StartThread(LogicThread, NULL, "Logic");
+}
+
+// After the thread has exited
+void logic_clear() {
+	AutoMutex(logicMutex);
+	logic_tasks.clear();
+	main_tasks.clear();
+	if (logic_sem != NULL) {
+		SDL_DestroySemaphore(logic_sem);
+		logic_sem = NULL;
+	}
+}
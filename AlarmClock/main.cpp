@@ -2,6 +2,8 @@
 // Copyright (c) 2026 Drift Solutions
 
 #include "alarmclock.h"
+#include <signal.h>
+#include <chrono>
 extern "C" {
     #include "sunriset.h"
 }
@@ -23,6 +25,8 @@ shared_ptr<AlarmConfig> cfg;
 CONFIG config;
 SDL_StatusBar status_bar;
 shared_ptr<Page> page_clock;
+// as close to exec() as we can get, for timing the first clock frame
+static const chrono::steady_clock::time_point process_start = chrono::steady_clock::now();
 
 // SDL2_mixer globals
 Mix_Chunk* alarm_chunk = NULL;
@@ -69,47 +73,17 @@ const CONFIG_COLORS colors = {
     { 0x42, 0x42, 0x42, 0xFF },
 };
 
-map<int, TTF_Font *> fonts;
-TTF_Font* GetFontSize(int ptSize) {
-    auto x = fonts.find(ptSize);
-    if (x != fonts.end()) {
-        return x->second;
-    }
-
-    auto font = TTF_OpenFont("resources/roboto.ttf", ptSize);
-    if (font == NULL) {
-        printf("Error opening font with point size %d: %s\n", ptSize, TTF_GetError());
-        return NULL;
-    }
-
-    fonts[ptSize] = font;
-    return font;
-}
-
-map<int, TTF_Font*> mono_fonts;
-TTF_Font* GetMonoFontSize(int ptSize) {
-    auto x = mono_fonts.find(ptSize);
-    if (x != mono_fonts.end()) {
-        return x->second;
-    }
-
-    auto font = TTF_OpenFont("resources/roboto_mono.ttf", ptSize);
-    if (font == NULL) {
-        printf("Error opening font with point size %d: %s\n", ptSize, TTF_GetError());
-        return NULL;
-    }
-
-    mono_fonts[ptSize] = font;
-    return font;
-}
-
 void shutdown(int err = 0) {
     printf("Shutting down...\n");
     config.shutdown_now = true;
+    logic_wake();
 
     while (DSL_NumThreads()) {
         safe_sleep(1);
     }
+    // anything the other threads left for us, like saving settings
+    main_run_posted();
+    logic_clear();
 
     if (Mix_Init(0)) {
         Mix_HaltChannel(-1);
@@ -122,20 +96,31 @@ void shutdown(int err = 0) {
         Mix_Quit();
     }
 
+    // pages own textures, so they have to go before the renderer does
+    config.next_page.reset();
+    config.cur_page.reset();
+    page_clock.reset();
+    config.side_menu.reset();
+    config.next_menu.reset();
     status_bar.Reset();
-
-    for (auto& f : fonts) {
-        TTF_CloseFont(f.second);
-    }
-    fonts.clear();
-    for (auto& f : mono_fonts) {
-        TTF_CloseFont(f.second);
-    }
-    mono_fonts.clear();
-    if (config.backup_font != NULL) {
-        TTF_CloseFont(config.backup_font);
-        config.backup_font = NULL;
-    }
+    text_async_clear();
+    text_cache_clear();
+    prewarm_clear();
+    shape_cache_clear();
+    image_cache_clear();
+    // after everything that holds sprites
+    atlas_clear();
+    texture_pool_clear();
+    scene_backbuffer_free();
+    texture_report_leaks();
+    raster_cache_save(true);
+    raster_cache_clear();
+
+    // backup_font is one of the shared sizes
+    config.backup_font = NULL;
+    close_fonts();
+    // the fonts can point into it
+    resource_pack_close();
 
     if (TTF_WasInit()) {
         TTF_Quit();
@@ -173,6 +158,14 @@ bool init() {
     cfg->ReadConfigFile();
 
     config.use_sun = cfg->GetBoolArg("-use_sun", false);
+    config.event_driven = cfg->GetBoolArg("-event_driven", true);
+    config.show_frame_stats = cfg->GetBoolArg("-show_frame_stats", false);
+    config.prewarm = cfg->GetBoolArg("-prewarm", true);
+    config.async_text = cfg->GetBoolArg("-async_text", true);
+    config.texture_budget = (int)max((int64)0, cfg->GetIntArg("-texture_budget", 64));
+    config.raster_cache = cfg->GetBoolArg("-raster_cache", true);
+    config.resource_pack = cfg->GetBoolArg("-resource_pack", true);
+    config.alarm_late_minutes = (int)max((int64)0, cfg->GetIntArg("-alarm_late_minutes", 60));
     config.lcd_brightness_fn = cfg->GetArg("-lcd_brightness_fn", "/sys/class/backlight/11-0045/brightness");
     config.home_assistant.url = cfg->GetArg("-home_assistant_url");
     config.home_assistant.token = cfg->GetArg("-home_assistant_token");
@@ -188,6 +181,8 @@ bool init() {
         fatal_error(mprintf("SDL could not initialize! SDL Error: %s\n", SDL_GetError()));
     }
     SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "best");
+    config.main_thread = SDL_ThreadID();
+    config.wake_event = SDL_RegisterEvents(1);
 
     printf("Init SDL_mixer...\n");
     if (Mix_Init(MIX_INIT_OGG | MIX_INIT_MP3 | MIX_INIT_FLAC | MIX_INIT_OPUS) == 0) {
@@ -251,10 +246,18 @@ bool init() {
         fatal_error(mprintf("Error initializing SDL_ttf! TTF Error: %s\n", TTF_GetError()));
     }
 
-    config.backup_font = TTF_OpenFont("resources/roboto.ttf", 14);
+    if (config.resource_pack) {
+        resource_pack_open();
+    }
+    config.backup_font = GetFontSize(14);
     if (config.backup_font == NULL) {
         fatal_error(mprintf("Error loading backup font! TTF Error: %s\n", TTF_GetError()));
     }
+    if (config.raster_cache) {
+        raster_cache_load();
+    }
+    // pack the menu icons now so opening a menu doesn't have to
+    image_cache_load();
 
     {
         shared_ptr<SDL_StatusBarSection> sec;
@@ -266,20 +269,21 @@ bool init() {
 
         int posw, posh;
         TTF_SizeUTF8(GetFontSize(STATUS_FONT_SIZE), "FPS: 1000", &posw, &posh);
+        double section_percent = config.show_frame_stats ? 25 : 33;
 
         status_bar.AddSection(sec);
         sec->align = SBA_LEFT;
-        sec->SetSizingPercent(33);
+        sec->SetSizingPercent(section_percent);
 
         //shared_ptr<SDL_StatusBarSection> sec;
         //SB_MPOS
         status_bar.AddSection(sec);
         sec->align = SBA_LEFT;
-        sec->SetSizingPercent(33);
+        sec->SetSizingPercent(section_percent);
 
         status_bar.AddSection(sec);
         sec->align = SBA_LEFT;
-        sec->SetSizingPercent(33);
+        sec->SetSizingPercent(section_percent);
 
         /*
         //SB_GPOS
@@ -314,6 +318,14 @@ bool init() {
         sec->SetSizingFixed(posw);
 #endif
 
+        if (config.show_frame_stats) {
+            //SB_FRAME_STATS
+            status_bar.AddSection(sec);
+            sec->align = SBA_CENTER;
+            sec->SetSizingPercent(section_percent);
+            sec->status_text = "Main loop p50/p95/p99/max";
+        }
+
         if (!config.home_assistant.isValid()) {            
             statusbar_set(SB_HOME_ASSISTANT_RECV, "HA: Disabled");
         }
@@ -380,6 +392,8 @@ void load_dynamic_settings() {
 }
 
 void save_dynamic_settings() {
+    // the menus change the alarm times in place
+    config.options.AlarmsChanged();
     UniValue obj(UniValue::VOBJ);
     config.options.ToUniValue(obj);
 
@@ -388,6 +402,7 @@ void save_dynamic_settings() {
     if (backup_file(fn)) {
         file_put_contents(fn, obj.write(1));
     }
+    logic_set_options(config.options);
 }
 
 
@@ -466,12 +481,44 @@ void on_resize() {
 
 void render() {
     auto r = config.mRenderer;
-    SDL_SetRenderDrawColor(r, colors.clock_bg);
-    SDL_RenderClear(r);
-
-    config.cur_page->Render();
+    const uint64 pending = text_async_pending_draws();
+    {
+        FrameTimer t(FP_PAGE_RENDER);
+        batch_begin();
+        auto scene = config.cur_page->GetScene();
+        if (scene == NULL || !scene->Render()) {
+            SDL_SetRenderDrawColor(r, colors.clock_bg);
+            SDL_RenderClear(r);
+            config.cur_page->Render();
+        }
+        batch_end();
+        text_cache_end_frame();
+        texture_budget_end_frame();
+    }
 
+    FrameTimer t(FP_PRESENT);
     SDL_RenderPresent(config.mRenderer);
+
+    // the first clock frame with nothing left waiting on the text worker
+    if (config.first_clock_frame_ms == 0 && page_clock && config.cur_page.get() == page_clock.get() && text_async_pending_draws() == pending) {
+        config.first_clock_frame_ms = max((uint64)1, (uint64)chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - process_start).count());
+        printf("First clock frame %llums after start (%s)\n", (unsigned long long)config.first_clock_frame_ms, raster_cache_stats().c_str());
+    }
+}
+
+void request_redraw() {
+    config.needs_redraw = true;
+    if (config.event_driven && SDL_ThreadID() != config.main_thread && config.wake_event != 0 && config.wake_event != (Uint32)-1) {
+        // the main loop may be blocked in SDL_WaitEventTimeout(), poke it
+        SDL_Event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.type = config.wake_event;
+        SDL_PushEvent(&ev);
+    }
+}
+
+void schedule_wakeup(Uint64 ms) {
+    config.timers.WakeWithin(ms);
 }
 
 void update_mouse_position(int x, int y) {
@@ -484,9 +531,19 @@ void handle_keypresses(const SDL_Event& event) {
         config.shutdown_now = true;
     } else if (event.key.keysym.sym == SDLK_RETURN) {
         config.ClearAlarm();
+    } else if (event.key.keysym.sym == SDLK_F12) {
+        frame_stats_dump();
     }
 }
 
+static volatile sig_atomic_t frame_stats_dump_requested = 0;
+#ifndef WIN32
+static void on_sigusr1(int sig) {
+    // picked up by the main loop the next time it wakes up
+    frame_stats_dump_requested = 1;
+}
+#endif
+
 void set_fps_target(Uint32 fps) {
     config.fps = fps;
     config.fps_target = 1000 / fps;
@@ -500,12 +557,17 @@ void SetNextPage(shared_ptr<Page>& p) {
         config.cur_page = p;
         p->OnActivate();
     }
+    request_redraw();
 }
 
 void SetPage(shared_ptr<Page> p) {
     config.next_page.reset();
+    if (config.cur_page) {
+        config.cur_page->OnDeactivate();
+    }
     config.cur_page = p;
     p->OnActivate();
+    request_redraw();
 }
 
 void get_page_clock(shared_ptr<Page>& page);
@@ -534,13 +596,10 @@ bool GetAlarmFile(string& fn) {
         if (supported & MIX_INIT_OPUS) {
             exts.insert("opus");
         }
-        Directory dir;
-        dir.Open("resources/alarms");
-        char buf[MAX_PATH];
-        bool is_dir;
-        while (dir.Read(buf, sizeof(buf), &is_dir)) {
-            if (buf[0] == '.' || is_dir) { continue; }
-            char* ext = strrchr(buf, '.');
+        vector<string> files;
+        resource_list("resources/alarms", files);
+        for (auto& ffn : files) {
+            const char* ext = strrchr(ffn.c_str(), '.');
             if (ext == NULL) { continue; }
 
             char* tmp = strdup(ext + 1);
@@ -551,8 +610,6 @@ bool GetAlarmFile(string& fn) {
                 continue;
             }
 
-            string ffn = "resources/alarms" PATH_SEPS "";
-            ffn += buf;
             alarm_files.push_back(ffn);
         }
     }
@@ -590,12 +647,8 @@ void wipe_old_logs() {
     }
 }
 
-inline void tick_30s() {
-    static Uint64 last = 0;
-    if (last && SDL_GetTicks64() - last < 30000) {
-        return;
-    }
-
+// Every 30 seconds on the logic thread's timers
+void tick_30s() {
     if (config.use_sun) {
         if (!config.home_assistant.info.hadRecentUpdate()) {
             // fallback for if we haven't been able to get info from Home Assistant, or if we aren't using the Home Assistant integration
@@ -631,45 +684,220 @@ inline void tick_30s() {
 
     // just in case there was some error setting it previously
     update_lcd_brightness();
+}
 
-    last = SDL_GetTicks64();
+/*
+* Alarm scheduling: the next alarm and the next midnight are worked out once, and each pass just compares the time
+* against them, so a stall or the clock jumping ahead doesn't mean walking through every second in between. They're
+* worked out again when one comes due or the options change.
+*
+* What happens across a gap (a stall, a long aplay, NTP stepping the clock):
+* - Alarms and midnights that came due during it are handled in order, each one once.
+* - An alarm is still sounded if it's at most alarm_late_minutes late. Past that it's logged as missed and skipped, so
+*   a Pi that boots with yesterday's time and then gets the real time from NTP doesn't go off for an alarm hours ago.
+*   A missed one-time alarm is still used up.
+* - If the clock goes back more than ALARM_CLOCK_BACK_LIMIT seconds, the minutes it went back over are checked again.
+*   Smaller steps back just wait, so an alarm can't go off twice.
+* - An alarm time that doesn't exist because of DST (the hour that gets skipped) doesn't go off that day, same as before.
+*   One that happens twice when DST ends goes off the first time only.
+*/
+#define ALARM_CLOCK_BACK_LIMIT 300
+
+static time_t alarm_checked_until = 0; // every alarm and midnight up to here has been handled
+static time_t alarm_next_fire = 0; // the next menu alarm, 0 = none set
+static AlarmIndex alarm_index; // the alarm table's, see alarms.cpp
+static time_t alarm_next_midnight = 0;
+static bool alarm_scheduled = false;
+static uint64 alarms_sounded = 0, alarms_missed = 0;
+static bool alarm_dry_run = false; // -test=alarms, only counts them: nothing is sounded, saved or wiped
+
+void alarm_schedule_changed() {
+    alarm_scheduled = false;
 }
 
-inline void alarm_loop() {
-    static time_t last = time(NULL);
-    static time_t lastAlarmAudioTime = 0;
+static time_t next_midnight_after(time_t ts) {
+    struct tm tm;
+    localtime_r(&ts, &tm);
+    tm.tm_mday++;
+    tm.tm_hour = tm.tm_min = tm.tm_sec = 0;
+    tm.tm_isdst = -1;
+    return mktime(&tm);
+}
 
-    time_t start = time(NULL);
-    while (last < start) {
-        bool is_whole_minute = (last % 60 == 0);
-        if (!is_whole_minute) {
-            last++;
-            continue;
+static void alarm_midnight() {
+    auto& options = logic_options();
+    if (!alarm_dry_run) {
+        wipe_old_logs();
+    }
+    if (options.auto_enable_at_midnight && !options.enable_alarm) {
+        printf("Re-enable alarm at midnight...\n");
+        // our copy right away so an alarm at midnight still goes off, the UI's copy is the one that gets saved
+        options.enable_alarm = true;
+        if (alarm_dry_run) {
+            return;
         }
+        main_post([]() {
+            config.options.enable_alarm = true;
+            save_dynamic_settings();
+        });
+    }
+}
 
-        struct tm cur;
-        localtime_r(&last, &cur);
+static void alarm_fire(time_t when, time_t now) {
+    auto& options = logic_options();
+    struct tm tm;
+    localtime_r(&when, &tm);
+    if (!options.enable_alarm || !options.ShouldAlarmAt(tm)) {
+        return;
+    }
 
-        if (cur.tm_hour == 0 && cur.tm_min == 0) {
-            wipe_old_logs();
-            if (config.options.auto_enable_at_midnight && !config.options.enable_alarm) {
-                printf("Re-enable alarm at midnight...\n");
-                config.options.enable_alarm = true;
-                save_dynamic_settings();
+    if (now - when > int64(config.alarm_late_minutes) * 60) {
+        printf("Missed the %s alarm by %s, not sounding it\n", tm_to_str(tm).c_str(), FormatMinutes(now - when).c_str());
+        alarms_missed++;
+    } else {
+        alarms_sounded++;
+        if (!alarm_dry_run) {
+            config.Alarm();
+        }
+    }
+
+    if (options.ConsumeOneTimeAlarm(tm) && !alarm_dry_run) {
+        // it only goes off once, even when it was missed
+        main_post([]() {
+            config.options.one_time_alarm = ALARM_TIME();
+            save_dynamic_settings();
+        });
+    }
+}
+
+static void alarm_fire_table(size_t ind, time_t when, time_t now) {
+    auto& options = logic_options();
+    if (ind >= options.alarms.size() || !options.enable_alarm) {
+        return;
+    }
+
+    ALARM& a = options.alarms[ind];
+    struct tm tm;
+    localtime_r(&when, &tm);
+    const string label = a.label.empty() ? tm_to_str(tm) : a.label;
+    if (now - when > int64(config.alarm_late_minutes) * 60) {
+        printf("Missed the %s alarm by %s, not sounding it\n", label.c_str(), FormatMinutes(now - when).c_str());
+        alarms_missed++;
+    } else {
+        printf("Alarm: %s\n", label.c_str());
+        alarms_sounded++;
+        if (!alarm_dry_run) {
+            config.Alarm(a.sound);
+        }
+    }
+
+    if (a.isOneTime()) {
+        // turned off once it's gone off, even when it was missed
+        a.enabled = false;
+        if (alarm_dry_run) {
+            return;
+        }
+        main_post([ind, a]() {
+            if (ind < config.options.alarms.size()) {
+                auto& cur = config.options.alarms[ind];
+                if (cur.label == a.label && cur.time.hour == a.time.hour && cur.time.minute == a.time.minute && cur.start == a.start) {
+                    cur.enabled = false;
+                    save_dynamic_settings();
+                }
+            }
+        });
+    }
+}
+
+time_t alarm_next_due() {
+    time_t ret = alarm_next_fire;
+    if (alarm_index.Next() > 0 && (ret == 0 || alarm_index.Next() < ret)) {
+        ret = alarm_index.Next();
+    }
+    return ret;
+}
+
+// Handles everything due up to now and returns when the next thing is
+static time_t alarm_schedule_run(time_t now) {
+    auto& options = logic_options();
+    if (alarm_checked_until == 0) {
+        // nothing from before we started
+        alarm_checked_until = now;
+    } else if (now < alarm_checked_until - ALARM_CLOCK_BACK_LIMIT) {
+        printf("The clock went back %s, checking those alarms again\n", FormatMinutes(alarm_checked_until - now).c_str());
+        alarm_checked_until = now;
+        alarm_scheduled = false;
+    }
+    if (!alarm_scheduled) {
+        alarm_next_fire = options.FindNextAlarm(alarm_checked_until + 1);
+        alarm_index.Build(options.alarms, alarm_checked_until + 1);
+        alarm_next_midnight = next_midnight_after(alarm_checked_until);
+        alarm_scheduled = true;
+    }
+
+    // one pass per alarm or midnight that's due, there's only more than one after a gap
+    for (int i = 0; i < 1000; i++) {
+        const time_t due = alarm_next_due();
+        const bool fire = (due > 0 && due <= alarm_next_midnight);
+        const time_t when = fire ? due : alarm_next_midnight;
+        if (when > now) {
+            break;
+        }
+        if (when <= alarm_checked_until) {
+            // already handled, it's only worked out again from after that and never fired twice
+            if (fire) {
+                if (alarm_next_fire == when) {
+                    alarm_next_fire = options.FindNextAlarm(when + 1);
+                }
+                if (alarm_index.Next() == when) {
+                    vector<size_t> inds;
+                    alarm_index.PopDue(options.alarms, when, inds);
+                }
+            } else {
+                alarm_next_midnight = next_midnight_after(alarm_checked_until);
             }
+            continue;
         }
+        frame_stats_add_us(FP_ALARM_LATENCY, (uint64)max<int64>(0, chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now().time_since_epoch()).count() - (int64(when) * 1000000)));
 
-        if (config.options.enable_alarm && config.options.ShouldAlarmAt(last, &cur)) {
-            config.Alarm();
+        alarm_checked_until = when;
+        if (fire) {
+            if (alarm_next_fire == when) {
+                alarm_fire(when, now);
+                alarm_next_fire = options.FindNextAlarm(alarm_checked_until + 1);
+            }
+            if (alarm_index.Next() == when) {
+                vector<size_t> inds;
+                alarm_index.PopDue(options.alarms, when, inds);
+                for (size_t ind : inds) {
+                    alarm_fire_table(ind, when, now);
+                }
+            }
+        } else {
+            alarm_midnight();
+            alarm_next_midnight = next_midnight_after(alarm_checked_until);
         }
+    }
+    alarm_checked_until = max(alarm_checked_until, now);
 
-        last++;
+    time_t next = alarm_next_midnight;
+    if (alarm_next_due() > 0 && alarm_next_due() < next) {
+        next = alarm_next_due();
     }
+    return next;
+}
+
+void alarm_loop() {
+    static time_t lastAlarmAudioTime = 0;
+
+    time_t now = time(NULL);
+    time_t next = alarm_schedule_run(now);
+    // right at the start of that second
+    logic_schedule_wakeup(ms_until_next_interval(1) + (Uint64(max<time_t>(next - now, 1)) - 1) * 1000);
 
     if (config.alarming) {
-        if (config.cur_page.get() != page_clock.get()) {
-            switch_to_clock();
-        }
+        // keep polling so the alarm sound gets restarted when it finishes
+        logic_schedule_wakeup(250);
         if (Mix_Playing(ALERT_CHANNEL) == 0) {
             if (alarm_chunk != NULL) {
                 Mix_FreeChunk(alarm_chunk);
@@ -678,7 +906,11 @@ inline void alarm_loop() {
 
             if (time(NULL) - lastAlarmAudioTime >= 5) {
                 string fn;
-                if (GetAlarmFile(fn)) {
+                if (!config.alarm_sound.empty() && access(("resources/alarms/" + config.alarm_sound).c_str(), 0) == 0) {
+                    // the table alarm that went off has its own
+                    fn = "resources/alarms/" + config.alarm_sound;
+                }
+                if (!fn.empty() || GetAlarmFile(fn)) {
                     printf("Attempting to play alarm file %s ...\n", fn.c_str());
                     alarm_chunk = Mix_LoadWAV(fn.c_str());
                     //Mix_Volume(ALERT_CHANNEL, int(MIX_MAX_VOLUME * 0.25));
@@ -705,6 +937,60 @@ inline void alarm_loop() {
     }
 }
 
+void handle_event(const SDL_Event& event) {
+    if (event.type == SDL_QUIT) {
+        //User requests quit
+        config.shutdown_now = true;
+    } else if (event.type == SDL_WINDOWEVENT) {
+        if (event.window.event == SDL_WINDOWEVENT_RESIZED || event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+            on_resize();
+        } else if (event.window.event == SDL_WINDOWEVENT_MOVED) {
+            if (!config.fullscreen) {
+                config.normal_win_position.x = event.window.data1;
+                config.normal_win_position.y = event.window.data2;
+            }
+            on_resize();
+        }
+        request_redraw();
+    } else if (event.type == SDL_MOUSEMOTION) {
+        update_mouse_position((int)event.motion.x, (int)event.motion.y);
+        //handle_mouse_motion(event);
+    } else if (event.type == SDL_MOUSEBUTTONUP) {
+        frame_stats_add_us(FP_INPUT_LATENCY, uint64(SDL_GetTicks() - event.button.timestamp) * 1000);
+        update_mouse_position((int)event.button.x, (int)event.button.y);
+        if (event.button.button == 1) {
+            SDL_Point pt = { (int)event.button.x, (int)event.button.y };
+            config.cur_page->OnClick(pt);
+            request_redraw();
+        }
+    } else if (event.type == SDL_KEYDOWN) {
+        frame_stats_add_us(FP_INPUT_LATENCY, uint64(SDL_GetTicks() - event.key.timestamp) * 1000);
+        handle_keypresses(event);
+        request_redraw();
+    } else if (event.type == SDL_RENDER_TARGETS_RESET || event.type == SDL_RENDER_DEVICE_RESET) {
+        scene_backbuffer_reset();
+        if (config.cur_page) {
+            config.cur_page->OnRenderTargetsReset();
+        }
+        request_redraw();
+    } else if (event.type == config.wake_event) {
+        // another thread changed something on screen
+        config.needs_redraw = true;
+    }
+}
+
+// Sleeps until an event arrives or the next timer in config.timers is due
+void wait_for_next_event() {
+    if (config.needs_redraw || config.shutdown_now || config.next_page) {
+        return;
+    }
+
+    SDL_Event event;
+    if (SDL_WaitEventTimeout(&event, (int)config.timers.TimeoutMs(60000))) {
+        handle_event(event);
+    }
+}
+
 #ifdef WIN32
 int APIENTRY WinMain(HINSTANCE hInst, HINSTANCE hInstPrev, PSTR cmdline, int cmdshow) {
 #define argc __argc
@@ -718,9 +1004,47 @@ int main(int argc, const char* argv[]) {
     cfg = make_shared<AlarmConfig>();
     cfg->ParseParameters(argc, argv);
 
+    if (cfg->GetBoolArg("-build_resource_pack", false)) {
+        // doesn't need a window or sound, so it can run at build time
+        return resource_pack_build() ? 0 : 1;
+    }
+    string test = cfg->GetArg("-test");
+    if (test == "alarms") {
+        return alarm_test() ? 0 : 1;
+    }
+    if (test == "timers") {
+        return timer_wheel_test() ? 0 : 1;
+    }
     if (!init()) {
         shutdown();
     }
+    string benchmark = cfg->GetArg("-benchmark");
+    if (benchmark == "shapes") {
+        shape_benchmark((int)cfg->GetIntArg("-benchmark_frames", 500));
+        shutdown();
+    }
+    if (benchmark == "text") {
+        text_benchmark((int)cfg->GetIntArg("-benchmark_frames", 500));
+        shutdown();
+    }
+    if (benchmark == "resources") {
+        resource_benchmark((int)cfg->GetIntArg("-benchmark_frames", 50));
+        shutdown();
+    }
+    if (benchmark == "alarms") {
+        alarm_benchmark((int)cfg->GetIntArg("-benchmark_days", 365));
+        shutdown();
+    }
+    if (config.async_text) {
+        start_text_worker();
+    }
+    if (config.prewarm) {
+        start_prewarm();
+    }
+    start_logic_thread();
+    if (config.show_frame_stats) {
+        config.timers.AddWallClock(1, frame_stats_update_readout);
+    }
 
     //Enable text input
     //SDL_StartTextInput();
@@ -731,17 +1055,23 @@ int main(int argc, const char* argv[]) {
     int cur_frame = 0;
 #endif
 
+#ifndef WIN32
+    signal(SIGUSR1, on_sigusr1);
+#endif
+
     printf("Loaded and ready.\n");
 
     //While application is running
     SDL_Event event;
     while (!config.shutdown_now) {
         Uint64 frame_start = SDL_GetTicks64();
+        FrameTimer frame_timer(FP_FRAME);
 
-        alarm_loop();
-        tick_30s();
-        if (config.home_assistant.isValid()) {
-            update_home_assistant();
+        main_run_posted();
+        config.timers.Run();
+        ui_state_update();
+        if (config.ui->alarming && config.cur_page.get() != page_clock.get()) {
+            switch_to_clock();
         }
 
         if (config.next_page) {
@@ -755,53 +1085,53 @@ int main(int argc, const char* argv[]) {
         }
 
         //Handle events on queue
-        while (SDL_PollEvent(&event) != 0) {
-            //User requests quit
-            if (event.type == SDL_QUIT) {
-                config.shutdown_now = true;
-            } else if (event.type == SDL_WINDOWEVENT) {
-                if (event.window.event == SDL_WINDOWEVENT_RESIZED || event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
-                    on_resize();
-                } else if (event.window.event == SDL_WINDOWEVENT_MOVED) {
-                    if (!config.fullscreen) {
-                        config.normal_win_position.x = event.window.data1;
-                        config.normal_win_position.y = event.window.data2;
-                    }
-                    on_resize();
-                }
-            } else if (event.type == SDL_MOUSEMOTION) {
-                update_mouse_position((int)event.motion.x, (int)event.motion.y);
-                //handle_mouse_motion(event);
-            } else if (event.type == SDL_MOUSEBUTTONUP) {
-                update_mouse_position((int)event.button.x, (int)event.button.y);
-                if (event.button.button == 1) {
-                    SDL_Point pt = { (int)event.button.x, (int)event.button.y };
-                    config.cur_page->OnClick(pt);
-                }
-            } else if (event.type == SDL_KEYDOWN) {
-                handle_keypresses(event);
+        {
+            FrameTimer t(FP_EVENTS);
+            while (SDL_PollEvent(&event) != 0) {
+                handle_event(event);
             }
         }
 
-        config.cur_page->Tick();
+        {
+            FrameTimer t(FP_PAGE_TICK);
+            config.cur_page->Tick();
+        }
 
-        render();
+        if (frame_stats_dump_requested) {
+            frame_stats_dump_requested = 0;
+            frame_stats_dump();
+        }
+
+        prewarm_upload();
+        text_async_process();
+        // cleared in the same step it's read, so a request from another thread while rendering isn't lost
+        if (config.needs_redraw.exchange(false) || !config.event_driven) {
+            render();
+            config.cur_frame++;
+#ifdef DEBUG_FPS
+            cur_frame++;
+#endif
+        }
 
-        Uint64 frame_end = SDL_GetTicks64();
-        if (frame_end >= frame_start) {
-            Uint64 took = frame_end - frame_start;
-            if (took < config.fps_target) {
-                SDL_Delay(config.fps_target - Uint32(took));
+        frame_timer.Stop();
+        if (config.event_driven) {
+            wait_for_next_event();
+        } else {
+            Uint64 frame_end = SDL_GetTicks64();
+            if (frame_end >= frame_start) {
+                Uint64 took = frame_end - frame_start;
+                if (took < config.fps_target) {
+                    SDL_Delay(config.fps_target - Uint32(took));
+                }
             }
         }
-        config.cur_frame++;
 #ifdef DEBUG_FPS
-        cur_frame++;
         if (time(NULL) != cur_sec) {
             statusbar_set(SB_FPS, mprintf("FPS: %d", cur_frame));
             cur_frame = 0;
             cur_sec = time(NULL);
         }
+        schedule_wakeup(ms_until_next_interval(1));
 #endif
     }
 
@@ -817,21 +1147,29 @@ int main(int argc, const char* argv[]) {
     return 0;
 }
 
-void CONFIG::Alarm() {
+void CONFIG::Alarm(const string& sound) {
     if (!_alarming) {
         printf("Alarm!\n");
         _alarming = true;
+        alarm_sound = sound;
     }
 }
 
 void CONFIG::ClearAlarm() {
+    if (!on_logic_thread()) {
+        logic_post([]() { config.ClearAlarm(); });
+        return;
+    }
     if (_alarming) {
         printf("Alarm acknowledged, shutting up now...\n");
         _alarming = false;
-        if (config.options.auto_enable_at_midnight) {
+        if (logic_options().auto_enable_at_midnight) {
             printf("Disabling alarm until midnight...\n");
-            config.options.enable_alarm = false;
-            save_dynamic_settings();
+            logic_options().enable_alarm = false;
+            main_post([]() {
+                config.options.enable_alarm = false;
+                save_dynamic_settings();
+            });
         }
     }
 }
@@ -844,52 +1182,58 @@ void CONFIG::SetIsDark(bool dark) {
             printf("It is now light outside...\n");
         }
         _is_dark = dark;
-        if (config.cur_page) {
-            config.cur_page->OnDarkChanged();
-        }
+        // the page hears about it from ui_state_update() once this is published
         update_lcd_brightness();
     }
 }
 
 void statusbar_set(SB_SECTIONS sec, const string& str) {
+    if (SDL_ThreadID() != config.main_thread) {
+        // the status bar is only touched by the main thread
+        main_post([sec, str]() { statusbar_set(sec, str); });
+        return;
+    }
     status_bar.SetSectionText(sec, str);
 }
 
 void statusbar_set_progress(SB_SECTIONS sec, size_t cur, size_t max) {
+    if (SDL_ThreadID() != config.main_thread) {
+        main_post([sec, cur, max]() { statusbar_set_progress(sec, cur, max); });
+        return;
+    }
     shared_ptr<SDL_StatusBarSection> s;
     if (status_bar.GetSection(sec, s)) {
-        s->progress_current = cur;
-        s->progress_max = max;
+        if (s->progress_current != cur || s->progress_max != max) {
+            s->progress_current = cur;
+            s->progress_max = max;
+            request_redraw();
+        }
     }
 }
 
-bool ConfigOptions::ShouldAlarmAt(time_t ts, tm* ptm) {
-    struct tm* tm = ptm;
-    if (ptm == NULL) {
-        static struct tm _tm;
-        localtime_r(&ts, &_tm);
-        tm = &_tm;
+void ConfigOptions::AlarmsChanged() {
+    alarm_minutes.reset();
+    for (int wday = 0; wday < 7; wday++) {
+        // a day of week alarm replaces the regular daily one
+        const ALARM_TIME& o = daily_alarms[wday].isValid() ? daily_alarms[wday] : alarm_time;
+        if (o.isValid()) {
+            alarm_minutes.set((wday * 1440) + (o.hour * 60) + o.minute);
+        }
     }
+}
 
-    vector<ALARM_TIME> opts;
-    if (one_time_alarm.isValid()) {
-        opts.push_back(one_time_alarm);
-    }
-    if (daily_alarms[tm->tm_wday].isValid()) {
-        opts.push_back(daily_alarms[tm->tm_wday]);
-    } else if (alarm_time.isValid()) {
-        opts.push_back(alarm_time);
+bool ConfigOptions::ShouldAlarmAt(const struct tm& tm) const {
+    if (one_time_alarm.isValid() && one_time_alarm.hour == tm.tm_hour && one_time_alarm.minute == tm.tm_min) {
+        return true;
     }
+    return alarm_minutes.test((tm.tm_wday * 1440) + (tm.tm_hour * 60) + tm.tm_min);
+}
 
-    for(auto& o : opts) {
-        if (o.hour == tm->tm_hour && o.minute == tm->tm_min) {
-            if (o.hour == one_time_alarm.hour && o.minute == one_time_alarm.minute) {
-                one_time_alarm.hour = -1;
-                one_time_alarm.minute = -1;
-                save_dynamic_settings();
-            }
-            return true;
-        }
+bool ConfigOptions::ConsumeOneTimeAlarm(const struct tm& tm) {
+    if (one_time_alarm.isValid() && one_time_alarm.hour == tm.tm_hour && one_time_alarm.minute == tm.tm_min) {
+        one_time_alarm = ALARM_TIME();
+        AlarmsChanged();
+        return true;
     }
     return false;
 }
@@ -897,21 +1241,19 @@ bool ConfigOptions::ShouldAlarmAt(time_t ts, tm* ptm) {
 time_t ConfigOptions::GetNextAlarmTime(time_t start) const {
     struct tm tm;
     localtime_r(&start, &tm);
-    tm.tm_sec = 0;
-    return GetNextAlarmTime(tm);
+    return GetNextAlarmTime(tm, start);
 }
 
-time_t ConfigOptions::GetNextAlarmTime(const struct tm& start) const {
-    assert(start.tm_wday >= 0 && start.tm_wday <= 6);
-    assert(start.tm_sec == 0);
+time_t ConfigOptions::GetNextAlarmTime(const struct tm& day, time_t from) const {
+    assert(day.tm_wday >= 0 && day.tm_wday <= 6);
 
     vector<ALARM_TIME> opts;
     if (one_time_alarm.isValid()) {
         opts.push_back(one_time_alarm);
     }
-    if (daily_alarms[start.tm_wday].isValid()) {
+    if (daily_alarms[day.tm_wday].isValid()) {
         // If there is a day of week alarm time for this day, then use it
-        opts.push_back(daily_alarms[start.tm_wday]);
+        opts.push_back(daily_alarms[day.tm_wday]);
     } else if (alarm_time.isValid()) {
         // Otherwise, use the regular daily alarm time
         opts.push_back(alarm_time);
@@ -919,34 +1261,213 @@ time_t ConfigOptions::GetNextAlarmTime(const struct tm& start) const {
 
     time_t ret = 0;
     for (auto& o : opts) {
-        if (o.hour > start.tm_hour || (o.hour == start.tm_hour && o.minute >= start.tm_min)) {
-            struct tm tm2 = start;
-            tm2.tm_hour = o.hour;
-            tm2.tm_min = o.minute;
-            time_t ts = mktime(&tm2);
-            if (ts >= 0 && (ret == 0 || ts < ret)) {
-                ret = ts;
-            }
+        // by the time it's first on the clock, so in the hour that happens twice when DST ends it's already gone by
+        // the second time around
+        time_t ts = local_time_on(day, o.hour, o.minute);
+        if (ts > 0 && ts >= from && (ret == 0 || ts < ret)) {
+            ret = ts;
         }
     }
 
     return ret;
 }
 
-time_t ConfigOptions::GetNextAlarmTime() const {
-    time_t start = time(NULL);
-    time_t ret = GetNextAlarmTime(start);
+time_t ConfigOptions::FindNextAlarm(time_t from) const {
+    if (from % 60) {
+        // alarms are on whole minutes
+        from += 60 - (from % 60);
+    }
+    struct tm tm;
+    localtime_r(&from, &tm);
+    time_t ret = GetNextAlarmTime(tm, from);
     int days = 0;
     while (ret <= 0 && days++ < 7) {
-        start += 86400;
-        struct tm tm;
-        localtime_r(&start, &tm);
-        tm.tm_hour = tm.tm_min = tm.tm_sec = 0;
-        ret = GetNextAlarmTime(tm);
+        // by the date, a day isn't always 86400 seconds. Noon so mktime() can't land on another day
+        tm.tm_mday++;
+        tm.tm_hour = 12;
+        tm.tm_min = tm.tm_sec = 0;
+        tm.tm_isdst = -1;
+        mktime(&tm);
+        ret = GetNextAlarmTime(tm, from);
     }
     return ret;
 }
 
+/*
+* -benchmark=alarms: works out the next menu alarm once for every minute of the simulated days and prints the average
+* time it took. The alarm times are the saved ones, or a weekday/weekend set if none are set. Then the alarm table at
+* growing sizes, see alarm_table_benchmark().
+*/
+void alarm_benchmark(int days) {
+    ConfigOptions opts = config.options;
+    if (opts.FindNextAlarm(time(NULL)) == 0) {
+        opts.alarm_time = { 7, 0 };
+        opts.daily_alarms[0] = { 9, 30 };
+        opts.daily_alarms[6] = { 9, 30 };
+        opts.one_time_alarm = { 5, 45 };
+        opts.AlarmsChanged();
+    }
+
+    time_t start = time(NULL);
+    start -= start % 60;
+    const int64 minutes = int64(max(days, 1)) * 1440;
+    printf("Alarm benchmark: %lld simulated minutes...\n", (long long)minutes);
+
+    // summed so the calls can't be optimized away
+    time_t sum = 0;
+    Uint64 freq = SDL_GetPerformanceFrequency();
+    Uint64 t = SDL_GetPerformanceCounter();
+    for (int64 i = 0; i < minutes; i++) {
+        sum += opts.FindNextAlarm(start + (i * 60));
+    }
+    double us = double(SDL_GetPerformanceCounter() - t) * 1000000.0 / double(freq) / double(minutes);
+
+    printf("Next alarm: %.3f us/query (%lld)\n", us, (long long)(sum % 1000));
+
+    alarm_table_benchmark();
+}
+
+/*
+* -test=alarms: runs the alarm scheduler on made up times and checks how many alarms go off: a gap with several due,
+* one too late, a missed one-time alarm, the clock going back more and less than ALARM_CLOCK_BACK_LIMIT and both DST
+* changes (US Eastern rules, so it doesn't need the zone files). Nothing is sounded or saved. Returns false if any fail.
+*/
+static time_t alarm_test_time(int year, int month, int day, int hour, int minute) {
+    struct tm tm = {};
+    tm.tm_year = year - 1900;
+    tm.tm_mon = month - 1;
+    tm.tm_mday = day;
+    return local_time_on(tm, hour, minute);
+}
+
+static void alarm_test_start(const ConfigOptions& opts, time_t now) {
+    logic_options() = opts;
+    logic_options().AlarmsChanged();
+    alarm_checked_until = 0;
+    alarm_scheduled = false;
+    alarms_sounded = alarms_missed = 0;
+    alarm_schedule_run(now);
+}
+
+static void alarm_test_run(time_t from, time_t to) {
+    // a pass a minute, like the logic thread waking up for each one
+    for (time_t t = from; t <= to; t += 60) {
+        alarm_schedule_run(t);
+    }
+}
+
+bool alarm_test() {
+#ifdef WIN32
+    _putenv_s("TZ", "EST5EDT,M3.2.0,M11.1.0");
+    _tzset();
+#else
+    setenv("TZ", "EST5EDT,M3.2.0,M11.1.0", 1);
+    tzset();
+#endif
+    alarm_dry_run = true;
+    config.alarm_late_minutes = 60;
+
+    int failed = 0;
+    auto check = [&failed](const char* name, uint64 sounded, uint64 missed, bool extra = true) {
+        bool ok = (alarms_sounded == sounded && alarms_missed == missed && extra);
+        printf("%s: %s (%llu sounded, %llu missed)\n", ok ? "PASS" : "FAIL", name, (unsigned long long)alarms_sounded, (unsigned long long)alarms_missed);
+        if (!ok) {
+            failed++;
+        }
+    };
+
+    ConfigOptions daily;
+    daily.enable_alarm = true;
+    daily.alarm_time = { 7, 0 };
+
+    {
+        ConfigOptions opts = daily;
+        ALARM a;
+        a.days = 0x7F;
+        a.time = { 7, 10 };
+        opts.alarms.push_back(a);
+        a.time = { 7, 20 };
+        opts.alarms.push_back(a);
+        a.days = 0;
+        a.time = { 7, 30 };
+        opts.alarms.push_back(a);
+        alarm_test_start(opts, alarm_test_time(2026, 6, 10, 6, 59));
+        alarm_schedule_run(alarm_test_time(2026, 6, 10, 7, 45));
+        alarm_schedule_run(alarm_test_time(2026, 6, 10, 7, 46));
+        check("gap with 4 alarms due", 4, 0, !logic_options().alarms[2].enabled);
+    }
+
+    alarm_test_start(daily, alarm_test_time(2026, 6, 10, 6, 59));
+    alarm_schedule_run(alarm_test_time(2026, 6, 10, 7, 59));
+    check("59 minutes late", 1, 0);
+
+    alarm_test_start(daily, alarm_test_time(2026, 6, 10, 6, 59));
+    alarm_schedule_run(alarm_test_time(2026, 6, 10, 8, 1));
+    check("61 minutes late", 0, 1);
+
+    {
+        ConfigOptions opts;
+        opts.enable_alarm = true;
+        opts.one_time_alarm = { 7, 0 };
+        alarm_test_start(opts, alarm_test_time(2026, 6, 10, 6, 59));
+        alarm_schedule_run(alarm_test_time(2026, 6, 10, 10, 0));
+        alarm_test_run(alarm_test_time(2026, 6, 10, 10, 1), alarm_test_time(2026, 6, 11, 7, 5));
+        check("missed one-time alarm used up", 0, 1, !logic_options().one_time_alarm.isValid());
+    }
+
+    alarm_test_start(daily, alarm_test_time(2026, 6, 10, 6, 59));
+    alarm_test_run(alarm_test_time(2026, 6, 10, 7, 0), alarm_test_time(2026, 6, 10, 7, 1));
+    alarm_test_run(alarm_test_time(2026, 6, 10, 6, 50), alarm_test_time(2026, 6, 10, 7, 1));
+    check("clock back 11 minutes", 2, 0);
+
+    alarm_test_start(daily, alarm_test_time(2026, 6, 10, 6, 59));
+    alarm_test_run(alarm_test_time(2026, 6, 10, 7, 0), alarm_test_time(2026, 6, 10, 7, 2));
+    alarm_test_run(alarm_test_time(2026, 6, 10, 6, 58), alarm_test_time(2026, 6, 10, 7, 2));
+    check("clock back 4 minutes", 1, 0);
+
+    {
+        // 2:00 goes to 3:00, so 2:30 only happens the next day
+        ConfigOptions opts;
+        opts.enable_alarm = true;
+        opts.alarm_time = { 2, 30 };
+        ALARM a;
+        a.days = 0x7F;
+        a.time = { 2, 30 };
+        opts.alarms.push_back(a);
+        alarm_test_start(opts, alarm_test_time(2026, 3, 8, 1, 0));
+        alarm_test_run(alarm_test_time(2026, 3, 8, 1, 1), alarm_test_time(2026, 3, 9, 3, 0));
+        check("DST starts", 2, 0);
+    }
+
+    {
+        // 2:00 goes back to 1:00, 1:30 and 1:45 go off the first time around
+        ConfigOptions opts;
+        opts.enable_alarm = true;
+        opts.alarm_time = { 1, 30 };
+        ALARM a;
+        a.days = 0x7F;
+        a.time = { 1, 45 };
+        opts.alarms.push_back(a);
+        const time_t second_hour = alarm_test_time(2026, 11, 1, 1, 0) + 3600;
+        alarm_test_start(opts, alarm_test_time(2026, 11, 1, 0, 0));
+        alarm_test_run(alarm_test_time(2026, 11, 1, 0, 1), alarm_test_time(2026, 11, 1, 3, 0));
+        check("DST ends", 2, 0);
+
+        // the options changing in the second 1:00 hour doesn't bring them back
+        alarm_test_start(opts, alarm_test_time(2026, 11, 1, 0, 0));
+        alarm_test_run(alarm_test_time(2026, 11, 1, 0, 1), second_hour + 600);
+        alarm_schedule_changed();
+        alarm_test_run(second_hour + 660, alarm_test_time(2026, 11, 1, 3, 0));
+        check("DST ends, options changed in the repeated hour", 2, 0);
+    }
+
+    alarm_dry_run = false;
+    // nothing it queued for the UI thread is real
+    logic_clear();
+    printf("Alarm tests: %d failed\n", failed);
+    return (failed == 0);
+}
+
 static void AlarmTimeToUniValue(const ALARM_TIME& at, UniValue& obj) {
     obj.setObject();
     obj.pushKV("hour", at.hour);
@@ -991,6 +1512,7 @@ void ConfigOptions::ToUniValue(UniValue& obj) {
     obj.pushKV("dim_when_dark", dim_when_dark);
     obj.pushKV("auto_enable_at_midnight", auto_enable_at_midnight);
     obj.pushKV("flip_clock_style", flip_clock_style);
+    obj.pushKV("show_seconds", show_seconds);
     obj.pushKV("time_format", int64(time_format));    
     obj.pushKV("screen_timeout", screen_timeout / 1000);
 
@@ -1010,6 +1532,14 @@ void ConfigOptions::ToUniValue(UniValue& obj) {
     }
     obj.pushKV("daily_alarms", da);
 
+    UniValue table(UniValue::VARR);
+    for (auto& a : alarms) {
+        UniValue tmp;
+        AlarmToUniValue(a, tmp);
+        table.push_back(tmp);
+    }
+    obj.pushKV("alarms", table);
+
     if (!config.fullscreen) {
         obj.pushKV("window_pos", PointToUniValue(config.normal_win_position));
     }
@@ -1032,6 +1562,9 @@ bool ConfigOptions::FromUniValue(const UniValue& obj) {
     if (obj.exists("flip_clock_style") && obj["flip_clock_style"].isBool()) {
         flip_clock_style = obj["flip_clock_style"].getBool();
     }    
+    if (obj.exists("show_seconds") && obj["show_seconds"].isBool()) {
+        show_seconds = obj["show_seconds"].getBool();
+    }
     if (obj.exists("screen_timeout") && obj["screen_timeout"].isNum()) {
         screen_timeout = (uint64)max((int64_t)1, obj["screen_timeout"].get_int64()) * 1000;
     }    
@@ -1054,6 +1587,17 @@ bool ConfigOptions::FromUniValue(const UniValue& obj) {
             AlarmTimeFromUniValue(daily_alarms[i], arr[i]);
         }
     }
+    if (obj.exists("alarms") && obj["alarms"].isArray()) {
+        const UniValue& arr = obj["alarms"];
+        alarms.clear();
+        for (size_t i = 0; i < arr.size(); i++) {
+            ALARM a;
+            if (AlarmFromUniValue(a, arr[i])) {
+                alarms.push_back(a);
+            }
+        }
+    }
+    AlarmsChanged();
 
     if (obj.exists("window_pos") && obj["window_pos"].isArray()) {
         PointFromUniValue(config.normal_win_position, obj["window_pos"]);
@@ -162,7 +162,7 @@ public:
 };
 */
 
-void switch_to_main_menu() {
+shared_ptr<Menu> create_main_menu() {
     shared_ptr<Menu> m = make_shared<Menu>();
     m->title = "Main Menu";
 
@@ -187,6 +187,11 @@ void switch_to_main_menu() {
     i = make_shared<MenuItem_MainMenu_Settings>();
     i->rc = config.menu_buttons.buttons[btn_ind++];
     m->items.push_back(i);
-    
+
+    return m;
+}
+
+void switch_to_main_menu() {
+    auto m = create_main_menu();
     switch_to_menu(m);
 }
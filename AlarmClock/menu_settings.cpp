@@ -27,7 +27,6 @@ public:
     virtual MENU_CLICK_RETURN OnPress() {
         config.options.dim_when_dark = !config.options.dim_when_dark;
         updateFooter();
-        update_lcd_brightness();
         if (config.cur_page) {
             config.cur_page->OnDarkChanged();
         }
@@ -94,6 +93,35 @@ public:
     }
 };
 
+class MenuItem_MainMenu_ShowSeconds : public MenuItem {
+public:
+    MenuItem_MainMenu_ShowSeconds() {
+        text = "Show Seconds";
+        updateFooter();
+    }
+
+    void updateFooter() {
+        footer = config.options.show_seconds ? "On" : "Off";
+    }
+
+    void getColors(SDL_Color& bgcol, SDL_Color& fgcol) {
+        if (config.options.show_seconds) {
+            bgcol = colors.menu_highlight_bg;
+            fgcol = colors.menu_highlight_text;
+        } else {
+            bgcol = colors.menu_normal_bg;
+            fgcol = colors.menu_normal_text;
+        }
+    }
+
+    virtual MENU_CLICK_RETURN OnPress() {
+        config.options.show_seconds = !config.options.show_seconds;
+        updateFooter();
+        save_dynamic_settings();
+        return MCR_DO_NOTHING;
+    }
+};
+
 class MenuItem_MainMenu_ScreenTimeout : public MenuItem {
 public:
     set<uint64> options = { 15000, 30000, 45000, 60000 };
@@ -167,7 +195,7 @@ public:
     }
 };
 
-void switch_to_menu_settings() {
+shared_ptr<Menu> create_menu_settings() {
     shared_ptr<Menu> m = make_shared<Menu>();
     m->title = "Settings";
 
@@ -193,9 +221,19 @@ void switch_to_menu_settings() {
     i->rc = config.menu_buttons.buttons[btn_ind++];
     m->items.push_back(i);    
 
-    i = make_shared<MenuItem_MainMenu_Exit>();
+    i = make_shared<MenuItem_MainMenu_ShowSeconds>();
     i->rc = config.menu_buttons.buttons[btn_ind++];
+    m->items.push_back(i);
+
+    // last, on the second page
+    i = make_shared<MenuItem_MainMenu_Exit>();
+    i->rc = config.menu_buttons.buttons[btn_ind++ % NUM_BUTTONS];
     m->items.push_back(i);    
 
+    return m;
+}
+
+void switch_to_menu_settings() {
+    auto m = create_menu_settings();
     switch_to_menu(m);
 }
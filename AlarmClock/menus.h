@@ -2,6 +2,7 @@
 // Copyright (c) 2026 Drift Solutions
 
 typedef void(*menu_item_clicked)(void* uData);
+struct TEXT_JOB;
 
 enum MENU_CLICK_RETURN {
 	MCR_NO_MATCH, // coordinates didn't match a button
@@ -15,9 +16,6 @@ enum MENU_CLICK_RETURN {
 
 class MenuItem {
 private:
-	SDL_Texture* img_tex = NULL;
-	SDL_Rect img_rc = { 0 };
-	Uint64 img_lastTry = 0;
 	int line_skip = -1;
 public:
 	string text;
@@ -37,7 +35,11 @@ public:
 
 	virtual void getColors(SDL_Color& bgcol, SDL_Color& fgcol) {} // the default will be the stock background/foreground colors, you don't need to do anything to keep them
 
+	void GetTextJobs(vector<TEXT_JOB>& jobs); // the text Draw() renders when there is no image
+	bool GetState(string& state); // appends everything Draw() output depends on, returns false if it needs to be drawn every frame anyway
 	virtual void Draw();
+
+	virtual ~MenuItem() {}
 };
 
 class Menu {
@@ -53,6 +55,18 @@ public:
 		}
 	}
 
+	bool GetState(string& state) {
+		bool ret = true;
+		state += title;
+		state += '\0';
+		for (size_t i = 0; i < NUM_BUTTONS && (i + first_ind) < items.size(); i++) {
+			if (!items[i + first_ind]->GetState(state)) {
+				ret = false;
+			}
+		}
+		return ret;
+	}
+
 	virtual void OnActivate() {
 		for (auto& itm : items) {
 			itm->OnActivate();
@@ -96,6 +110,7 @@ void add_menu_about_lines(vector<string>& keys, vector<string>& funcs); #pragma
 
 struct ALARM_TIME;
 
+shared_ptr<Menu> create_main_menu();
 void switch_to_main_menu();
 void switch_to_menu_set_alarm(ALARM_TIME* target, const string& title);
 void switch_to_menu_set_alarm_dow();
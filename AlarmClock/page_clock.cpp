@@ -5,10 +5,14 @@
 
 class FlipClockDigit {
 public:
-	SDL_Rect rc = { 0 };
+	SDL_Rect rc = { 0 }; // relative to the face texture
 	shared_ptr<CachedText> txt = make_shared<CachedText>();
 };
 
+/*
+* The digits and their cards only change when the time does, so the whole face is composited into one texture and
+* copied as-is until then. Each digit keeps its own CachedText, so only the digits that actually changed get rasterized.
+*/
 class FlipClock {
 private:
 	string str;
@@ -18,110 +22,342 @@ private:
 	const int vert_padding = 10;
 	const int hor_spacing = 10;
 	const int border_radius = 10;
+	const int face_margin = 2; // the card outlines overhang their rects by a pixel or two
 
 	SDL_Color text_col = { 0 };
-public:
-	~FlipClock() {
-		Reset();
-	}
-
-	void SetString(const string& pstr) {
-		if (str != pstr) {
-			Reset();
-			str = pstr;
-		}
-	}
 
-	void Render() {
-		if (str.empty()) { return; }
+	SDL_Rect face_rc = { 0 }; // where the face goes on screen
+	SDL_Rect layout_area = { 0 }; // config.main_area the layout was made for
+	SDL_Texture* face_tex = NULL;
+	uint32 face_version = 0; // goes up every time face_tex is redrawn
+	bool face_dirty = true;
+	bool face_dark = false;
+	bool face_failed = false;
 
+	void layout() {
 		auto font = GetMonoFontSize(FLIP_TIME_FONT_SIZE);
-		//str = "12:55p";
-
-		digits.clear();
-		if (digits.size() == 0) {
-			SDL_Size max_size = { 0 };
-			TTF_SizeUTF8(font, "X", &max_size.w, &max_size.h);
-
-			const int cell_w = (max_size.w + (hor_padding * 2));
-			const int total_w = (cell_w * (int)str.length()) + (hor_spacing * (int)(str.length() - 1));
-			const int cell_h = (max_size.h + (vert_padding * 2));
-
-			int cx = config.main_area.x + ((config.main_area.w - total_w) / 2);
-			int cy = config.main_area.y + ((config.main_area.h - cell_h) / 2);
+		SDL_Size max_size = { 0 };
+		TTF_SizeUTF8(font, "X", &max_size.w, &max_size.h);
 
-			for (size_t i = 0; i < str.length(); i++) {
-				FlipClockDigit d;
-				d.rc = { cx, cy, cell_w, cell_h };
-				d.txt->setRect(d.rc);
-				d.txt->align = DTA_CENTER | DTA_MIDDLE;
-				d.txt->font_size = FLIP_TIME_FONT_SIZE;
-				d.txt->setColor(text_col);
-				d.txt->setText(str.substr(i, 1));
+		const int cell_w = (max_size.w + (hor_padding * 2));
+		const int total_w = (cell_w * (int)str.length()) + (hor_spacing * (int)(str.length() - 1));
+		const int cell_h = (max_size.h + (vert_padding * 2));
 
-				digits.push_back(std::move(d));
+		face_rc = {
+			config.main_area.x + ((config.main_area.w - total_w) / 2),
+			config.main_area.y + ((config.main_area.h - cell_h) / 2),
+			total_w,
+			cell_h
+		};
+		layout_area = config.main_area;
 
-				cx += cell_w + hor_spacing;
-			}
+		digits.clear();
+		int cx = face_margin;
+		for (size_t i = 0; i < str.length(); i++) {
+			FlipClockDigit d;
+			d.rc = { cx, face_margin, cell_w, cell_h };
+			d.txt->setRect(d.rc);
+			d.txt->align = DTA_CENTER | DTA_MIDDLE;
+			d.txt->font_size = FLIP_TIME_FONT_SIZE;
+			d.txt->setColor(text_col);
+			d.txt->setText(str.substr(i, 1));
+
+			digits.push_back(std::move(d));
+
+			cx += cell_w + hor_spacing;
 		}
 
+		freeFace();
+	}
+
+	// Draws the face with its top left corner (including the margin) at 0,0 of the current viewport/target
+	void drawFace() {
 		int hinge_h = 23;
 		int hinge_w = hor_padding / 2;
 
-		SDL_SetRenderDrawColor(config.mRenderer, { 0xff,0,0,0xff });
 		for (auto& d : digits) {
 			const auto& rc = d.rc;
 			const auto& border = text_col;
-			//SDL_Rect rc = { config.main_area.x, config.main_area.y, total_w, cell_h };
-			//SDL_RenderDrawRect(config.mRenderer, &d.rc);
-			if (!config.is_dark) {
-				const auto& bg = colors.menu_page_bg;
-				roundedBoxRGBA(config.mRenderer, rc.x, rc.y, rc.x + rc.w, rc.y + rc.h, border_radius, bg.r, bg.g, bg.b, bg.a);
+			if (!config.ui->is_dark) {
+				draw_rounded_box(rc, border_radius, colors.menu_page_bg);
 			}
-			roundedRectangleRGBA(config.mRenderer, rc.x, rc.y, rc.x + rc.w, rc.y + rc.h, border_radius, border.r, border.g, border.b, border.a);
-			roundedRectangleRGBA(config.mRenderer, rc.x, rc.y + 1, rc.x + rc.w, rc.y + rc.h + 1, border_radius, border.r, border.g, border.b, border.a);
-			roundedRectangleRGBA(config.mRenderer, rc.x, rc.y - 1, rc.x + rc.w, rc.y + rc.h - 1, border_radius, border.r, border.g, border.b, border.a);
+			draw_rounded_rect(rc, border_radius, border);
+			draw_rounded_rect({ rc.x, rc.y + 1, rc.w, rc.h }, border_radius, border);
+			draw_rounded_rect({ rc.x, rc.y - 1, rc.w, rc.h }, border_radius, border);
 
-			rectangleRGBA(config.mRenderer, rc.x, rc.y + (rc.h / 2) - (hinge_h / 2), rc.x + hinge_w, rc.y + (rc.h / 2) + (hinge_h / 2), border.r, border.g, border.b, border.a);
-			rectangleRGBA(config.mRenderer, rc.x + rc.w - hinge_w, rc.y + (rc.h / 2) - (hinge_h / 2), rc.x + rc.w + 1, rc.y + (rc.h / 2) + (hinge_h / 2), border.r, border.g, border.b, border.a);
+			// same pixels as the rectangleRGBA()/thickLineRGBA() calls these used to be, but they stay in the sprite batch
+			const int hinge_y = rc.y + (rc.h / 2) - (hinge_h / 2);
+			draw_outline({ rc.x, hinge_y, hinge_w + 1, (hinge_h / 2) * 2 + 1 }, border);
+			draw_outline({ rc.x + rc.w - hinge_w, hinge_y, hinge_w + 2, (hinge_h / 2) * 2 + 1 }, border);
 
 			d.txt->Draw();
 
-			thickLineRGBA(config.mRenderer, rc.x + hinge_w, rc.y + (rc.h / 2) - 1, rc.x + rc.w - hinge_w - 1, rc.y + (rc.h / 2) - 1, 3, colors.clock_bg.r, colors.clock_bg.g, colors.clock_bg.b, colors.clock_bg.a);
+			draw_fill({ rc.x + hinge_w, rc.y + (rc.h / 2) - 2, rc.w - (hinge_w * 2), 3 }, colors.clock_bg);
+		}
+	}
+
+	bool updateFace() {
+		if (face_failed) {
+			return false;
+		}
+		if (face_tex == NULL) {
+			if (!SDL_RenderTargetSupported(config.mRenderer)) {
+				face_failed = true;
+				return false;
+			}
+			face_tex = texture_create(TO_FLIP_FACE, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, face_rc.w + (face_margin * 2), face_rc.h + (face_margin * 2));
+			if (face_tex == NULL) {
+				printf("Error creating flip clock texture: %s\n", SDL_GetError());
+				face_failed = true;
+				return false;
+			}
+			// it's filled with the background color, so a plain copy is enough (SDL defaults it to blending)
+			SDL_SetTextureBlendMode(face_tex, SDL_BLENDMODE_NONE);
+			texture_set_evict(face_tex, [this]() { freeFace(); });
+			face_dirty = true;
+		}
+		texture_touch(face_tex);
+		if (!face_dirty) {
+			return true;
+		}
+
+		batch_flush();
+		if (SDL_SetRenderTarget(config.mRenderer, face_tex) != 0) {
+			printf("Error setting flip clock texture as render target: %s\n", SDL_GetError());
+			freeFace();
+			face_failed = true;
+			return false;
+		}
+		// opaque background, the page is cleared to the same color so the face can be copied without blending
+		SDL_SetRenderDrawColor(config.mRenderer, colors.clock_bg);
+		SDL_RenderClear(config.mRenderer);
+		uint64 pending = text_async_pending_draws();
+		drawFace();
+		batch_flush();
+		SDL_SetRenderTarget(config.mRenderer, NULL);
+		// a digit is still on the text worker, draw the face again once it's done
+		face_dirty = (text_async_pending_draws() != pending);
+		face_version++;
+		return true;
+	}
+
+	void freeFace() {
+		if (face_tex != NULL) {
+			texture_destroy(face_tex);
+			face_tex = NULL;
+		}
+		face_dirty = true;
+	}
+public:
+	~FlipClock() {
+		Reset();
+	}
+
+	void SetString(const string& pstr) {
+		if (str == pstr) {
+			return;
+		}
+		if (str.length() != pstr.length()) {
+			// 9:59 -> 10:00 changes the number of cards
+			digits.clear();
+		} else {
+			for (size_t i = 0; i < digits.size(); i++) {
+				digits[i].txt->setText(pstr.substr(i, 1));
+			}
+		}
+		str = pstr;
+		face_dirty = true;
+		request_redraw();
+	}
+
+	// Lays out and redraws the face texture if needed, has to happen while the screen is the render target
+	void Prepare() {
+		if (str.empty()) { return; }
+
+		if (digits.size() == 0 || memcmp(&layout_area, &config.main_area, sizeof(SDL_Rect))) {
+			layout();
+		}
+		if (face_dark != config.ui->is_dark) {
+			face_dark = config.ui->is_dark;
+			face_dirty = true;
+		}
+		updateFace();
+	}
+
+	// Returns false if there is no face texture and it's drawn from scratch every time
+	bool GetState(string& state) {
+		state += mprintf("%u|", face_version);
+		state += str;
+		return !face_failed;
+	}
+
+	SDL_Rect GetBounds() {
+		if (str.empty()) {
+			return { 0, 0, 0, 0 };
+		}
+		return { face_rc.x - face_margin, face_rc.y - face_margin, face_rc.w + (face_margin * 2), face_rc.h + (face_margin * 2) };
+	}
+
+	void Render() {
+		Prepare();
+		Draw();
+	}
+
+	// Draws the face as of the last Prepare()
+	void Draw() {
+		if (str.empty()) { return; }
+
+		SDL_Rect rc = GetBounds();
+		batch_flush();
+		if (face_tex != NULL && !face_failed) {
+			SDL_RenderCopy(config.mRenderer, face_tex, NULL, &rc);
+		} else {
+			// the clip rect is relative to the viewport, so it can't be kept
+			SDL_Rect clip = { 0, 0, 0, 0 };
+			SDL_RenderGetClipRect(config.mRenderer, &clip);
+			SDL_RenderSetClipRect(config.mRenderer, NULL);
+			SDL_RenderSetViewport(config.mRenderer, &rc);
+			drawFace();
+			batch_flush();
+			SDL_RenderSetViewport(config.mRenderer, NULL);
+			SDL_RenderSetClipRect(config.mRenderer, (clip.w || clip.h) ? &clip : NULL);
 		}
 	}
 
 	void Reset() {
 		digits.clear();
+		freeFace();
+	}
+
+	void OnRenderTargetsReset() {
+		face_dirty = true;
 	}
 
 	void setTextColor(const SDL_Color& col) {
-		text_col = col;
-		for (auto& d : digits) {
-			d.txt->setColor(col);
+		if (memcmp(&text_col, &col, sizeof(SDL_Color))) {
+			text_col = col;
+			for (auto& d : digits) {
+				d.txt->setColor(col);
+			}
+			face_dirty = true;
 		}
 	}
 };
 
+class ClockTimeNode : public SceneNode {
+public:
+	DigitAtlas& txt;
+
+	ClockTimeNode(DigitAtlas& ptxt) : txt(ptxt) {}
+
+	bool GetState(string& state) {
+		txt.GetState(state);
+		return true;
+	}
+	SDL_Rect GetBounds() {
+		return txt.GetBounds();
+	}
+	void Draw() {
+		txt.Draw();
+	}
+};
+
+class FlipClockNode : public SceneNode {
+public:
+	FlipClock& flip;
+
+	FlipClockNode(FlipClock& pflip) : flip(pflip) {}
+
+	void Prepare() {
+		flip.Prepare();
+	}
+	bool GetState(string& state) {
+		return flip.GetState(state);
+	}
+	SDL_Rect GetBounds() {
+		return flip.GetBounds();
+	}
+	void Draw() {
+		flip.Draw();
+	}
+};
+
+class AlarmBannerNode : public SceneNode {
+public:
+	TEXT_JOB job;
+
+	AlarmBannerNode() {
+		job.type = TJ_FIXED_WRAPPED;
+		job.ptSize = ALARM_FONT_SIZE;
+		job.align = DTA_CENTER | DTA_MIDDLE;
+		job.str = "Time to Wake Up!";
+	}
+
+	bool GetState(string& state) {
+		job.rc = config.main_area;
+		job.col = colors.clock_text;
+		state += mprintf("%d,%d,%d,%d", job.rc.x, job.rc.y, job.rc.w, job.rc.h);
+		return true;
+	}
+	SDL_Rect GetBounds() {
+		return config.main_area;
+	}
+	void Draw() {
+		draw_text(job);
+	}
+};
+
+/*
+* Everything on the clock is a scene node, so the minute tick only redraws the time and the date/weather only get
+* redrawn when they actually change.
+*/
 class PageClock : public Page {
 public:
-	CachedText txtTime, txtDate, txtAlarm, txtWeather;
+	Scene scene;
+	shared_ptr<SceneTextNode> nodeAlarm = make_shared<SceneTextNode>(), nodeWeather = make_shared<SceneTextNode>(), nodeDate = make_shared<SceneTextNode>();
+	CachedText& txtDate = nodeDate->txt;
+	CachedText& txtAlarm = nodeAlarm->txt;
+	CachedText& txtWeather = nodeWeather->txt;
+	DigitAtlas txtTime;
 	FlipClock flip;
+	shared_ptr<SceneNode> nodeTime = make_shared<ClockTimeNode>(txtTime), nodeFlip = make_shared<FlipClockNode>(flip), nodeBanner = make_shared<AlarmBannerNode>();
 
-	int64 last_time = 0;
+	TimerWheel::ID time_timer = 0;
 	bool have_weather = false;
 	SDL_Color text_col = colors.clock_text;
 
+	PageClock() {
+		scene.bg = colors.clock_bg;
+		scene.Add(nodeAlarm);
+		scene.Add(nodeWeather);
+		scene.Add(nodeDate);
+		scene.Add(nodeTime);
+		scene.Add(nodeFlip);
+		scene.Add(nodeBanner);
+#ifdef DEBUG_FPS
+		status_bar.AddToScene(scene);
+#endif
+	}
+
 	void OnActivate();
+	void OnDeactivate();
 	void OnClick(const SDL_Point& pt);
 	void Tick();
+	void UpdateTime();
 	void Render();
+	Scene* GetScene() {
+		return &scene;
+	}
 
 	void OnDarkChanged();
+	void OnRenderTargetsReset() {
+		flip.OnRenderTargetsReset();
+		scene.DamageAll();
+	}
 };
 
 void PageClock::OnDarkChanged() {
-	if (config.is_dark && config.options.dim_when_dark) {
+	if (config.ui->is_dark && config.options.dim_when_dark) {
 		text_col = colors.clock_red_text;
 	} else {
 		text_col = colors.clock_text;
@@ -152,22 +388,38 @@ void PageClock::OnActivate() {
 	txtWeather.align = DTA_RIGHT | DTA_MIDDLE;
 
 	OnDarkChanged();
+
+	// the seconds and clock style settings are only changed from the menus, so they can't change while we're up
+	UpdateTime();
+	config.timers.Cancel(time_timer);
+	const bool seconds = config.options.show_seconds && !config.options.flip_clock_style;
+	time_timer = config.timers.AddWallClock(seconds ? 1 : 60, [this]() { UpdateTime(); });
 }
 
-void PageClock::Tick() {
+void PageClock::OnDeactivate() {
+	config.timers.Cancel(time_timer);
+}
+
+void PageClock::UpdateTime() {
 	time_t cur_time = time(NULL);
-	if (last_time == 0 || (cur_time != last_time && cur_time % 60 == 0)) {
-		struct tm tm;
-		localtime_r(&cur_time, &tm);
-		char buf[128] = { 0 };
-		strftime(buf, sizeof(buf), "%A, %B %e, %Y", &tm);
-		txtDate.setText(buf);
+	const bool seconds = config.options.show_seconds && !config.options.flip_clock_style;
+	struct tm tm;
+	localtime_r(&cur_time, &tm);
+	char buf[128] = { 0 };
+	strftime(buf, sizeof(buf), "%A, %B %e, %Y", &tm);
+	txtDate.setText(buf);
+
+	txtTime.setText(tm_to_str(tm, seconds));
+	flip.SetString(tm_to_str(tm));
+}
 
-		txtTime.setText(tm_to_str(tm));
-		flip.SetString(tm_to_str(tm));
-	}
+void PageClock::Tick() {
+	nodeAlarm->visible = config.options.enable_alarm;
+	nodeBanner->visible = config.ui->alarming;
+	nodeFlip->visible = !config.ui->alarming && config.options.flip_clock_style;
+	nodeTime->visible = !config.ui->alarming && !config.options.flip_clock_style;
 
-	auto& ha = config.home_assistant.info;
+	auto& ha = config.ui->ha;
 	if (ha.hadRecentUpdate() && !ha.weather.empty()) {
 		string str = ha.weather;
 		if (ha.temp > DBL_MIN && !ha.weather.empty()) {
@@ -180,7 +432,7 @@ void PageClock::Tick() {
 }
 
 void PageClock::OnClick(const SDL_Point& pt) {
-	if (config.alarming) {
+	if (config.ui->alarming) {
 		config.ClearAlarm();
 	} else {
 		switch_to_main_menu();
@@ -188,24 +440,7 @@ void PageClock::OnClick(const SDL_Point& pt) {
 }
 
 void PageClock::Render() {
-	if (config.options.enable_alarm) {
-		txtAlarm.Draw();
-	}
-	if (!txtWeather.str.empty()) {
-		txtWeather.Draw();
-	}
-	txtDate.Draw();
-	if (config.alarming) {
-		draw_text_wrapped(GetFontSize(ALARM_FONT_SIZE), config.main_area, DTA_CENTER | DTA_MIDDLE, colors.clock_text, "Time to Wake Up!");
-	} else if (config.options.flip_clock_style) {
-		flip.Render();
-	} else {
-		txtTime.Draw();
-	}
-
-#ifdef DEBUG_FPS
-	status_bar.Draw();
-#endif
+	scene.Draw();
 
 	/*
 	{
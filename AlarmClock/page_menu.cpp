@@ -4,10 +4,61 @@
 #include "alarmclock.h"
 #include <list>
 
+class PageMenu;
+
+// One menu button slot, side menu buttons are slots in config.side_menu
+class MenuItemNode : public SceneNode {
+private:
+	PageMenu* page;
+	bool side;
+	size_t slot;
+public:
+	MenuItemNode(PageMenu* ppage, bool pside, size_t pslot) : page(ppage), side(pside), slot(pslot) {}
+
+	shared_ptr<MenuItem> GetItem();
+	bool GetState(string& state) {
+		return GetItem()->GetState(state);
+	}
+	SDL_Rect GetBounds() {
+		// the outlines are drawn inclusive of x + w/y + h
+		const auto& rc = GetItem()->rc;
+		return { rc.x - 1, rc.y - 1, rc.w + 3, rc.h + 3 };
+	}
+	void Draw() {
+		GetItem()->Draw();
+	}
+};
+
+class MenuTitleNode : public SceneNode {
+private:
+	PageMenu* page;
+public:
+	MenuTitleNode(PageMenu* ppage) : page(ppage) {}
+
+	bool GetState(string& state);
+	SDL_Rect GetBounds() {
+		return config.title_area;
+	}
+	void Draw();
+};
+
+/*
+* The title, every button and every status bar section are scene nodes, so pressing a button or a new "Next alarm"
+* only redraws that button or section and a menu that's just sitting there costs one copy per frame.
+*/
 class PageMenu : public Page {
 private:
-	Uint64 lastActivity = SDL_GetTicks64();
-	Uint32 updateNextAlarmTicks = 0;
+	TimerWheel::ID timeout_timer = 0, next_alarm_timer = 0;
+	bool next_alarm_dirty = true;
+	uint64 next_alarm_generation = 0; // the config.ui it was last shown from
+
+	Scene scene;
+	shared_ptr<SceneNode> nodeTitle;
+	vector<shared_ptr<SceneNode>> nodeSide, nodeItems;
+
+	void updateNodes();
+	void updateNextAlarm();
+	void armTimeout();
 public:
 	list<shared_ptr<Menu>> stack;
 	shared_ptr<Menu> menu;
@@ -15,16 +66,79 @@ public:
 
 	PageMenu(shared_ptr<Menu>& pmenu) {
 		menu = pmenu;
+
+		scene.bg = colors.menu_page_bg;
+		if (config.side_menu) {
+			for (size_t i = 0; i < config.side_menu->items.size(); i++) {
+				nodeSide.push_back(make_shared<MenuItemNode>(this, true, i));
+				scene.Add(nodeSide.back());
+			}
+		}
+		nodeTitle = make_shared<MenuTitleNode>(this);
+		scene.Add(nodeTitle);
+		for (size_t i = 0; i < NUM_BUTTONS; i++) {
+			nodeItems.push_back(make_shared<MenuItemNode>(this, false, i));
+			scene.Add(nodeItems.back());
+		}
+		status_bar.AddToScene(scene);
 	}
 
 	void OnActivate();
+	void OnDeactivate();
 	void OnClick(const SDL_Point& pt);
 	void Tick();
 	void Render();
+	Scene* GetScene() {
+		return &scene;
+	}
+	void OnRenderTargetsReset() {
+		scene.DamageAll();
+	}
 };
 
+shared_ptr<MenuItem> MenuItemNode::GetItem() {
+	if (side) {
+		return config.side_menu->items[slot];
+	}
+	return page->menu->items[page->menu->first_ind + slot];
+}
+
+bool MenuTitleNode::GetState(string& state) {
+	state += page->menu->title;
+	return true;
+}
+
+void MenuTitleNode::Draw() {
+	draw_text(GetFontSize(TITLE_FONT_SIZE), config.title_area, DTA_CENTER | DTA_MIDDLE, colors.menu_normal_text, page->menu->title);
+}
+
+// Which nodes have something to draw depends on the current menu and page of it
+void PageMenu::updateNodes() {
+	nodeTitle->visible = (menu.get() != NULL);
+	for (size_t i = 0; i < nodeItems.size(); i++) {
+		nodeItems[i]->visible = (menu && (i + menu->first_ind) < menu->items.size());
+	}
+}
+
+void PageMenu::armTimeout() {
+	if (menu) {
+		config.timers.Set(timeout_timer, menu->GetMenuTimeout(), []() { switch_to_clock(); });
+	} else {
+		config.timers.Cancel(timeout_timer);
+	}
+}
+
+void PageMenu::OnDeactivate() {
+	config.timers.Cancel(timeout_timer);
+	config.timers.Cancel(next_alarm_timer);
+}
+
 void PageMenu::OnActivate() {
-	lastActivity = SDL_GetTicks64();
+	armTimeout();
+	next_alarm_dirty = true;
+	config.timers.Cancel(next_alarm_timer);
+	// "Today" turns into "Tomorrow" and the alarm passes without anything being clicked
+	next_alarm_timer = config.timers.AddWallClock(60, [this]() { updateNextAlarm(); });
 	if (config.side_menu) {
 		config.side_menu->items[0]->rc = config.menu_buttons.back;
 		config.side_menu->items[1]->rc = config.menu_buttons.home;
@@ -58,10 +172,26 @@ string get_relative_day_string(const struct tm& target) {
 	return buf;
 };
 
-void PageMenu::Tick() {
-	if (menu && SDL_GetTicks64() - lastActivity > menu->GetMenuTimeout()) {
-		switch_to_clock();
+void PageMenu::updateNextAlarm() {
+	next_alarm_dirty = false;
+	// the logic thread's, it has the next alarm lined up already
+	next_alarm_generation = config.ui->generation;
+	if (config.ui->enable_alarm) {
+		time_t ts = config.ui->next_alarm;
+		if (ts > 0) {
+			struct tm tm;
+			localtime_r(&ts, &tm);
+			statusbar_set(SB_NEXT_ALARM, mprintf("Next alarm: %s %s", get_relative_day_string(tm).c_str(), tm_to_str(tm).c_str()));
+			//statusbar_set(SB_NEXT_ALARM, mprintf("Next alarm_chunk: %d/%d %s", tm.tm_mon + 1, tm.tm_mday, tm_to_str(tm).c_str()));
+		} else {
+			statusbar_set(SB_NEXT_ALARM, "No Times Set");
+		}
+	} else {
+		statusbar_set(SB_NEXT_ALARM, "Alarm Off");
 	}
+}
+
+void PageMenu::Tick() {
 	if (config.next_menu) {
 		if (menu) {
 			stack.push_back(menu);
@@ -69,6 +199,8 @@ void PageMenu::Tick() {
 		menu = config.next_menu;
 		menu->RecalcRects();
 		config.next_menu.reset();
+		// it might have a different timeout
+		armTimeout();
 	}
 	back_button->enabled = (stack.size() != 0);
 	if (prev_button) {
@@ -78,25 +210,16 @@ void PageMenu::Tick() {
 		next_button->enabled = (menu && menu->first_ind + NUM_BUTTONS < menu->items.size());
 	}
 
-	if (updateNextAlarmTicks++ % config.fps == 0) {
-		if (config.options.enable_alarm) {
-			time_t ts = config.options.GetNextAlarmTime();
-			if (ts > 0) {
-				struct tm tm;
-				localtime_r(&ts, &tm);
-				statusbar_set(SB_NEXT_ALARM, mprintf("Next alarm: %s %s", get_relative_day_string(tm).c_str(), tm_to_str(tm).c_str()));
-				//statusbar_set(SB_NEXT_ALARM, mprintf("Next alarm_chunk: %d/%d %s", tm.tm_mon + 1, tm.tm_mday, tm_to_str(tm).c_str()));
-			} else {
-				statusbar_set(SB_NEXT_ALARM, "No Times Set");
-			}
-		} else {
-			statusbar_set(SB_NEXT_ALARM, "Alarm Off");
-		}
+	if (next_alarm_dirty || next_alarm_generation != config.ui->generation) {
+		updateNextAlarm();
 	}
+	updateNodes();
 }
 
 void PageMenu::OnClick(const SDL_Point& pt) {
-	lastActivity = SDL_GetTicks64();
+	armTimeout();
+	// the click might have changed the alarms
+	next_alarm_dirty = true;
 
 	MENU_CLICK_RETURN ret = MCR_NO_MATCH;
 	if (config.side_menu) {
@@ -115,6 +238,7 @@ void PageMenu::OnClick(const SDL_Point& pt) {
 			menu = *stack.rbegin();
 			menu->OnActivate();
 			stack.pop_back();
+			armTimeout();
 		} else {
 			switch_to_clock();
 		}
@@ -126,17 +250,7 @@ void PageMenu::OnClick(const SDL_Point& pt) {
 }
 
 void PageMenu::Render() {
-	SDL_SetRenderDrawColor(config.mRenderer, colors.menu_page_bg);
-	SDL_RenderClear(config.mRenderer);
-
-	if (config.side_menu) {
-		config.side_menu->Draw();
-	}
-	if (menu) {
-		draw_text(GetFontSize(TITLE_FONT_SIZE), config.title_area, DTA_CENTER | DTA_MIDDLE, colors.menu_normal_text, menu->title);
-		menu->Draw();
-	}
-	status_bar.Draw();
+	scene.Draw();
 }
 
 void create_page_menu(shared_ptr<Page>& page, shared_ptr<Menu>& menu) {
@@ -154,46 +268,82 @@ void switch_to_menu(shared_ptr<Menu>& menu) {
 	}
 }
 
-void MenuItem::Draw() {
-	int rad = 10;
+void MenuItem::GetTextJobs(vector<TEXT_JOB>& jobs) {
 	SDL_Color bg = enabled ? colors.menu_normal_bg : colors.menu_inactive_bg;
 	SDL_Color fg = enabled ? colors.menu_normal_text : colors.menu_inactive_text;
 	getColors(bg, fg);
 
-	roundedBoxRGBA(config.mRenderer, rc.x, rc.y, rc.x + rc.w, rc.y + rc.h, rad, bg.r, bg.g, bg.b, bg.a);
-
 	if (line_skip <= 0) {
 		auto ffont = GetFontSize(FOOTER_FONT_SIZE);
 		line_skip = TTF_FontLineSkip(ffont);
 	}
 
-	if (!image.empty()) {
-		if (img_tex == NULL && (img_lastTry == 0 || SDL_GetTicks64() - img_lastTry >= 10000)) {
-			img_rc = { 0 };
-			string fn = "resources/images/" + image;
-			SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "1");
-			auto src = IMG_Load(fn.c_str());
-			if (src != NULL) {
-				img_tex = SDL_CreateTextureFromSurface(config.mRenderer, src);
-				if (img_tex != NULL) {
-					img_rc = { 0, 0, src->w, src->h };
-				}
-				SDL_FreeSurface(src);
-			} else {
-				int x = 1;
-			}
-			img_lastTry = SDL_GetTicks64();
-		}
+	TEXT_JOB job;
+	job.type = TJ_FIT_WRAPPED;
+	job.align = DTA_CENTER | DTA_MIDDLE;
+	job.col = fg;
+	if (footer.empty()) {
+		job.ptSize = MENU_FONT_SIZE;
+		job.rc = rc;
+		job.str = text;
+		jobs.push_back(job);
+	} else {
+		job.ptSize = FOOTER_FONT_SIZE;
+		job.rc = {
+			rc.x,
+			rc.y + rc.h - line_skip - 2,
+			rc.w,
+			line_skip
+		};
+		job.str = footer;
+		jobs.push_back(job);
+
+		job.ptSize = MENU_FONT_SIZE;
+		job.rc = rc;
+		job.rc.h -= line_skip;
+		job.str = text;
+		jobs.push_back(job);
+	}
+}
 
-		if (img_tex != NULL) {
+bool MenuItem::GetState(string& state) {
+	SDL_Color bg = enabled ? colors.menu_normal_bg : colors.menu_inactive_bg;
+	SDL_Color fg = enabled ? colors.menu_normal_text : colors.menu_inactive_text;
+	getColors(bg, fg);
+
+	state.append((const char*)&rc, sizeof(rc));
+	state.append((const char*)&bg, sizeof(bg));
+	state.append((const char*)&fg, sizeof(fg));
+	state += enabled ? '1' : '0';
+	const SPRITE* icon = image.empty() ? NULL : image_cache_get(image);
+	state += (icon != NULL) ? '1' : '0';
+	state += text;
+	state += '\0';
+	state += footer;
+	state += '\0';
+
+	// an image that failed to load gets retried from Draw()
+	return image.empty() || icon != NULL;
+}
+
+void MenuItem::Draw() {
+	int rad = 10;
+	SDL_Color bg = enabled ? colors.menu_normal_bg : colors.menu_inactive_bg;
+	SDL_Color fg = enabled ? colors.menu_normal_text : colors.menu_inactive_text;
+	getColors(bg, fg);
+
+	draw_rounded_box(rc, rad, bg);
+
+	if (!image.empty()) {
+		const SPRITE* icon = image_cache_get(image);
+		if (icon != NULL) {
 			SDL_Rect padded = {
 				rc.x + 5,
 				rc.y + 5,
 				rc.w - 10,
 				rc.h - 10
 			};
-			auto rc2 = ScaleRectToFit(img_rc, padded);
-			SDL_RenderCopy(config.mRenderer, img_tex, NULL, &rc2);
+			image_cache_draw(*icon, padded);
 			return;
 		}
 	}
@@ -218,21 +368,16 @@ void MenuItem::Draw() {
 	*/
 
 	//draw_text(GetFontSize(MENU_FONT_SIZE), rc, DTA_CENTER | DTA_MIDDLE, colors.menu_normal_text, text.c_str());
-	if (footer.empty()) {
-		draw_text_wrapped(MENU_FONT_SIZE, rc, DTA_CENTER | DTA_MIDDLE, fg, text);
-	} else {
-		SDL_Rect rc3 = {
-			rc.x,
-			rc.y + rc.h - line_skip - 2,
-			rc.w,
-			line_skip
-		};
-		thickLineRGBA(config.mRenderer, rc3.x, rc3.y, rc3.x + rc3.w, rc3.y, 2, colors.menu_frame.r, colors.menu_frame.g, colors.menu_frame.b, colors.menu_frame.a);
-		draw_text_wrapped(FOOTER_FONT_SIZE, rc3, DTA_CENTER | DTA_MIDDLE, fg, footer);
-
-		SDL_Rect rc2 = rc;
-		rc2.h -= line_skip;
-		draw_text_wrapped(MENU_FONT_SIZE, rc2, DTA_CENTER | DTA_MIDDLE, fg, text);
+	vector<TEXT_JOB> jobs;
+	GetTextJobs(jobs);
+	if (!footer.empty()) {
+		// the footer is the first job, with a divider along its top
+		const auto& rc3 = jobs[0].rc;
+		SDL_Rect line = { rc3.x, rc3.y - 1, rc3.w + 1, 2 }; // 2px divider, used to be a thickLineRGBA()
+		draw_fill(line, colors.menu_frame);
+	}
+	for (auto& job : jobs) {
+		draw_text(job);
 	}
 }
 
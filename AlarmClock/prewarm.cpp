@@ -0,0 +1,203 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2026 Drift Solutions
+
+#include "alarmclock.h"
+#include <set>
+
+/*
+* Startup warm-up. Everything the first clock minute and the first trip through the menus would otherwise do on the
+* render thread is done here instead: the shared font faces get opened, clock/label sizes get fit, and menu text gets
+* rasterized with private faces (or copied out of the raster cache from the last run). The render thread only has to
+* upload the finished surfaces and merge the fit answers.
+*/
+
+struct PREWARM_FIT {
+	string str;
+	int max_size;
+	SDL_Size box;
+	uint8 flags;
+};
+
+static vector<PREWARM_FIT> fit_jobs;
+static vector<TEXT_JOB> text_jobs;
+
+static DSL_Mutex prewarmMutex;
+static vector<pair<TEXT_CACHE_KEY, SDL_Surface*>> ready;
+static shared_ptr<TextFitter> finished_fitter;
+static bool prewarm_active = false;
+static Uint64 prewarm_start = 0;
+static size_t prewarm_cached = 0; // strings that came from the raster cache
+
+static void add_menu_jobs(const shared_ptr<Menu>& m) {
+	TEXT_JOB job;
+	job.type = TJ_FIXED;
+	job.ptSize = TITLE_FONT_SIZE;
+	job.rc = config.title_area;
+	job.align = DTA_CENTER | DTA_MIDDLE;
+	job.col = colors.menu_normal_text;
+	job.str = m->title;
+	text_jobs.push_back(job);
+
+	for (auto& itm : m->items) {
+		// items past the first page don't have a rect until they're paged to
+		if (itm->image.empty() && itm->rc.w > 0 && itm->rc.h > 0) {
+			itm->GetTextJobs(text_jobs);
+		}
+	}
+}
+
+// Everything the rendered surface depends on, the screen position doesn't matter
+static string raster_key(const TEXT_JOB& job) {
+	const bool wrapped = (job.type == TJ_FIXED_WRAPPED || job.type == TJ_FIT_WRAPPED);
+	const bool fit = (job.type == TJ_FIT || job.type == TJ_FIT_WRAPPED);
+	string ret = mprintf("text:%d,%d,%d,%d,%d,%d|", job.type, job.ptSize, job.style, (wrapped || fit) ? job.rc.w : 0, fit ? job.rc.h : 0, wrapped ? job.align : 0);
+	ret += job.str;
+	return ret;
+}
+
+DSL_DEFINE_THREAD(PrewarmThread) {
+	DSL_THREAD_START
+
+	auto faces = make_shared<map<int, TTF_Font*>>();
+	auto fitter = make_shared<TextFitter>([faces](int ptSize) -> TTF_Font* {
+		auto x = faces->find(ptSize);
+		if (x != faces->end()) {
+			return x->second;
+		}
+		auto font = OpenPrivateFontSize(ptSize);
+		if (font != NULL) {
+			(*faces)[ptSize] = font;
+		}
+		return font;
+	});
+
+	// the render thread's own faces, we only open them so it doesn't have to
+	const int sizes[] = { TITLE_FONT_SIZE, TIME_FONT_SIZE, ALARM_FONT_SIZE, MENU_FONT_SIZE, FOOTER_FONT_SIZE, STATUS_FONT_SIZE };
+	for (auto s : sizes) {
+		GetFontSize(s);
+	}
+	GetMonoFontSize(FLIP_TIME_FONT_SIZE);
+
+	for (auto& f : fit_jobs) {
+		if (config.shutdown_now) {
+			break;
+		}
+		GetFontSize(fitter->FitSize(f.str, f.max_size, f.box, TTF_STYLE_NORMAL, f.flags));
+	}
+
+	for (auto& job : text_jobs) {
+		if (config.shutdown_now) {
+			break;
+		}
+		const string rkey = raster_key(job);
+		auto src = raster_cache_get(rkey);
+		if (src != NULL) {
+			prewarm_cached++;
+		} else {
+			src = text_job_render(job, *fitter);
+			raster_cache_put(rkey, src);
+		}
+		if (src != NULL) {
+			auto key = text_job_key(job);
+			AutoMutex(prewarmMutex);
+			ready.emplace_back(key, src);
+		}
+	}
+
+	for (auto& x : *faces) {
+		ClosePrivateFont(x.second);
+	}
+	faces->clear();
+
+	{
+		AutoMutex(prewarmMutex);
+		finished_fitter = fitter;
+	}
+	// wake the render thread up so it picks up the results
+	request_redraw();
+	// so the next start has them even if this one doesn't exit cleanly. Here instead of on the render thread, it's a
+	// few MB to write out
+	raster_cache_save(true);
+
+	DSL_THREAD_END
+}
+
+void start_prewarm() {
+	prewarm_start = SDL_GetTicks64();
+	prewarm_cached = 0;
+	fit_jobs.clear();
+	text_jobs.clear();
+
+	// every digit pattern the clock can show in the current time format
+	set<string> patterns;
+	const bool seconds = config.options.show_seconds && !config.options.flip_clock_style;
+	for (int hour = 0; hour < 24; hour++) {
+		struct tm tm = { 0 };
+		tm.tm_hour = hour;
+		patterns.insert(DigitAtlas::Pattern(tm_to_str(tm, seconds)));
+	}
+	for (auto& p : patterns) {
+		fit_jobs.push_back({ p, TIME_FONT_SIZE, { config.win_size.w, config.win_size.h }, TFF_WIDTH | TFF_HEIGHT });
+	}
+
+	time_t now = time(NULL);
+	struct tm tm;
+	localtime_r(&now, &tm);
+	char buf[128] = { 0 };
+	strftime(buf, sizeof(buf), "%A, %B %e, %Y", &tm);
+	fit_jobs.push_back({ buf, TITLE_FONT_SIZE, { config.win_size.w, config.win_size.h - 10 }, TFF_WIDTH | TFF_HEIGHT });
+	fit_jobs.push_back({ "Alarm On", TITLE_FONT_SIZE, { config.title_area.w, config.title_area.h }, TFF_WIDTH | TFF_HEIGHT });
+
+	add_menu_jobs(create_main_menu());
+	add_menu_jobs(create_menu_settings());
+
+	TEXT_JOB job;
+	job.type = TJ_FIXED_WRAPPED;
+	job.ptSize = ALARM_FONT_SIZE;
+	job.rc = config.main_area;
+	job.align = DTA_CENTER | DTA_MIDDLE;
+	job.col = colors.clock_text;
+	job.str = "Time to Wake Up!";
+	text_jobs.push_back(job);
+
+	prewarm_active = true;
+	DSL_StartThread(PrewarmThread, NULL, "Font Pre-warm");
+}
+
+void prewarm_upload() {
+	if (!prewarm_active) {
+		return;
+	}
+
+	vector<pair<TEXT_CACHE_KEY, SDL_Surface*>> tmp;
+	shared_ptr<TextFitter> fitter;
+	{
+		AutoMutex(prewarmMutex);
+		tmp.swap(ready);
+		fitter.swap(finished_fitter);
+	}
+
+	for (auto& x : tmp) {
+		// pinned so an idle clock face doesn't age them out before the menu is ever opened
+		text_cache_add(x.first, x.second, true);
+		SDL_FreeSurface(x.second);
+	}
+
+	if (fitter) {
+		text_fit_merge(*fitter);
+		prewarm_active = false;
+		printf("Pre-warm finished in %llums (%zu strings, %zu from the raster cache, %zu sizes fit)\n", (unsigned long long)(SDL_GetTicks64() - prewarm_start), text_jobs.size(), prewarm_cached, fit_jobs.size());
+		fit_jobs.clear();
+		text_jobs.clear();
+	}
+}
+
+void prewarm_clear() {
+	AutoMutex(prewarmMutex);
+	for (auto& x : ready) {
+		SDL_FreeSurface(x.second);
+	}
+	ready.clear();
+	finished_fitter.reset();
+	prewarm_active = false;
+}
@@ -0,0 +1,347 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2026 Drift Solutions
+
+#include "alarmclock.h"
+#ifndef WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/*
+* Rasterized pictures kept on disk between runs (raster_cache.bin in the data dir): the clock digit atlases, menu
+* labels and decoded menu icons. After a restart they're copied straight out of the file instead of being rendered with
+* FreeType or decoded from PNG again. The file is mapped like the fonts are and starts with a hash of everything the
+* pictures depend on that isn't in their keys (font files, window size, SDL_ttf version, format version), so any change
+* there throws the whole file out.
+*
+* Pixels are stored as ARGB8888 with straight alpha, the way they're uploaded, since every UI texture uses
+* SDL_BLENDMODE_BLEND.
+*/
+
+#define RASTER_CACHE_MAGIC 0x43524341 // "ACRC"
+#define RASTER_CACHE_VERSION 1
+#define RASTER_CACHE_MAX_BYTES (48 * 1024 * 1024) // anything past this that wasn't used this run isn't written back
+#define RASTER_CACHE_SAVE_INTERVAL 60000 // ms between saves of new entries
+
+struct RASTER_CACHE_HEADER {
+	uint32 magic;
+	uint32 version;
+	uint64 hash;
+	uint32 count;
+};
+
+struct RASTER_CACHE_ENTRY {
+	int w = 0, h = 0;
+	string extra;
+	const uint8* pixels = NULL; // w * h * 4 bytes, in the mapped file or in owned
+	shared_ptr<const string> owned; // shared with a save that's writing it out
+	bool used = false;
+};
+
+static DSL_Mutex rasterMutex;
+static map<string, RASTER_CACHE_ENTRY> entries;
+static uint64 inputs_hash = 0;
+static const uint8* file_data = NULL;
+static size_t file_len = 0;
+static bool file_mapped = false;
+static string file_buf;
+static bool loaded = false, dirty = false, saving = false;
+static Uint64 last_save = 0;
+static uint64 raster_hits = 0, raster_misses = 0;
+
+uint64 hash_bytes(uint64 h, const void* data, size_t len) {
+	// FNV-1a
+	const uint8* p = (const uint8*)data;
+	for (size_t i = 0; i < len; i++) {
+		h ^= p[i];
+		h *= 0x100000001B3ULL;
+	}
+	return h;
+}
+
+static string cache_file() {
+	return cfg->GetDataDirFile("raster_cache.bin");
+}
+
+static void unmap_file() {
+#ifndef WIN32
+	if (file_mapped) {
+		munmap((void*)file_data, file_len);
+	}
+#endif
+	file_mapped = false;
+	file_data = NULL;
+	file_len = 0;
+	file_buf.clear();
+	file_buf.shrink_to_fit();
+}
+
+static bool map_file(const string& fn) {
+#ifndef WIN32
+	int fd = open(fn.c_str(), O_RDONLY);
+	if (fd != -1) {
+		struct stat st;
+		if (fstat(fd, &st) == 0 && st.st_size > 0) {
+			void* p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (p != MAP_FAILED) {
+				file_data = (const uint8*)p;
+				file_len = st.st_size;
+				file_mapped = true;
+			}
+		}
+		close(fd);
+	}
+#endif
+
+	if (file_data == NULL) {
+		if (!file_get_contents(fn, file_buf) || file_buf.empty()) {
+			return false;
+		}
+		file_data = (const uint8*)file_buf.data();
+		file_len = file_buf.length();
+	}
+	return true;
+}
+
+// Pulls a value off the front of the file, false if there isn't enough left
+template<typename T> static bool read_value(size_t& pos, T& val) {
+	if (file_len - pos < sizeof(T)) {
+		return false;
+	}
+	memcpy(&val, file_data + pos, sizeof(T));
+	pos += sizeof(T);
+	return true;
+}
+
+static bool read_string(size_t& pos, string& str) {
+	uint32 len = 0;
+	if (!read_value(pos, len) || file_len - pos < len) {
+		return false;
+	}
+	str.assign((const char*)file_data + pos, len);
+	pos += len;
+	return true;
+}
+
+void raster_cache_load() {
+	AutoMutex(rasterMutex);
+	loaded = true;
+
+	inputs_hash = hash_bytes(0xCBF29CE484222325ULL, &config.win_size, sizeof(config.win_size));
+	const SDL_version* ttf = TTF_Linked_Version();
+	inputs_hash = hash_bytes(inputs_hash, ttf, sizeof(SDL_version));
+	uint32 version = RASTER_CACHE_VERSION;
+	inputs_hash = hash_bytes(inputs_hash, &version, sizeof(version));
+	inputs_hash = font_files_hash(inputs_hash);
+
+	Uint64 start = SDL_GetTicks64();
+	string fn = cache_file();
+	if (access(fn.c_str(), 0) != 0) {
+		printf("Raster cache: %s doesn't exist yet, it will be made after startup\n", fn.c_str());
+		return;
+	}
+	if (!map_file(fn)) {
+		printf("Raster cache: error reading %s\n", fn.c_str());
+		return;
+	}
+
+	size_t pos = 0;
+	RASTER_CACHE_HEADER hdr;
+	if (!read_value(pos, hdr) || hdr.magic != RASTER_CACHE_MAGIC || hdr.version != RASTER_CACHE_VERSION) {
+		printf("Raster cache: %s isn't a raster cache or is from another version, it will be rebuilt\n", fn.c_str());
+		unmap_file();
+		return;
+	}
+	if (hdr.hash != inputs_hash) {
+		printf("Raster cache: fonts or screen size changed, it will be rebuilt\n");
+		unmap_file();
+		return;
+	}
+
+	for (uint32 i = 0; i < hdr.count; i++) {
+		string key;
+		RASTER_CACHE_ENTRY e;
+		int32 wh[2];
+		if (!read_string(pos, key) || !read_string(pos, e.extra) || !read_value(pos, wh)) {
+			break;
+		}
+		const size_t bytes = size_t(max(0, wh[0])) * size_t(max(0, wh[1])) * 4;
+		if (wh[0] <= 0 || wh[1] <= 0 || file_len - pos < bytes) {
+			break;
+		}
+		e.w = wh[0];
+		e.h = wh[1];
+		e.pixels = file_data + pos;
+		pos += bytes;
+		entries[key] = std::move(e);
+	}
+	if (entries.size() != hdr.count) {
+		printf("Raster cache: %s is truncated, kept the first %zu of %u entries\n", fn.c_str(), entries.size(), hdr.count);
+	}
+	printf("Raster cache: mapped %zu entries (%zu KB) in %llums\n", entries.size(), file_len / 1024, (unsigned long long)(SDL_GetTicks64() - start));
+}
+
+SDL_Surface* raster_cache_get(const string& key, string* extra) {
+	AutoMutex(rasterMutex);
+	auto x = entries.find(key);
+	if (x == entries.end()) {
+		raster_misses++;
+		return NULL;
+	}
+
+	auto& e = x->second;
+	SDL_Surface* ret = SDL_CreateRGBSurfaceWithFormat(0, e.w, e.h, 32, SDL_PIXELFORMAT_ARGB8888);
+	if (ret == NULL) {
+		return NULL;
+	}
+	for (int y = 0; y < e.h; y++) {
+		memcpy((uint8*)ret->pixels + (size_t(y) * ret->pitch), e.pixels + (size_t(y) * e.w * 4), size_t(e.w) * 4);
+	}
+	if (extra != NULL) {
+		*extra = e.extra;
+	}
+	e.used = true;
+	raster_hits++;
+	return ret;
+}
+
+void raster_cache_put(const string& key, SDL_Surface* src, const string& extra) {
+	if (src == NULL || src->w <= 0 || src->h <= 0) {
+		return;
+	}
+	{
+		AutoMutex(rasterMutex);
+		if (!loaded) {
+			return;
+		}
+	}
+	SDL_Surface* conv = src;
+	if (src->format->format != SDL_PIXELFORMAT_ARGB8888) {
+		conv = SDL_ConvertSurfaceFormat(src, SDL_PIXELFORMAT_ARGB8888, 0);
+		if (conv == NULL) {
+			return;
+		}
+	}
+
+	RASTER_CACHE_ENTRY e;
+	e.w = conv->w;
+	e.h = conv->h;
+	e.extra = extra;
+	auto buf = make_shared<string>(size_t(e.w) * size_t(e.h) * 4, '\0');
+	for (int y = 0; y < e.h; y++) {
+		memcpy(&(*buf)[size_t(y) * e.w * 4], (const uint8*)conv->pixels + (size_t(y) * conv->pitch), size_t(e.w) * 4);
+	}
+	e.pixels = (const uint8*)buf->data();
+	e.owned = buf;
+	e.used = true;
+	if (conv != src) {
+		SDL_FreeSurface(conv);
+	}
+
+	AutoMutex(rasterMutex);
+	entries[key] = std::move(e);
+	dirty = true;
+}
+
+static void write_value(string& out, const void* p, size_t len) {
+	out.append((const char*)p, len);
+}
+
+static void write_string(string& out, const string& str) {
+	uint32 len = (uint32)str.length();
+	write_value(out, &len, sizeof(len));
+	out += str;
+}
+
+/*
+* Only the list of entries is copied under the lock, their pixels are shared with the cache (the mapped file stays
+* until raster_cache_clear() and owned buffers are reference counted), so building the file and writing it out doesn't
+* hold up raster_cache_get() on other threads.
+*/
+void raster_cache_save(bool force) {
+	vector<pair<string, RASTER_CACHE_ENTRY>> order;
+	uint64 hash;
+	{
+		AutoMutex(rasterMutex);
+		if (!loaded || !dirty || saving || (!force && SDL_GetTicks64() - last_save < RASTER_CACHE_SAVE_INTERVAL)) {
+			return;
+		}
+		last_save = SDL_GetTicks64();
+		saving = true;
+		dirty = false;
+		hash = inputs_hash;
+
+		// what was used this run goes first, old entries fill whatever room is left
+		order.reserve(entries.size());
+		for (int pass = 0; pass < 2; pass++) {
+			for (auto& x : entries) {
+				if (x.second.used == (pass == 0)) {
+					order.push_back(x);
+				}
+			}
+		}
+	}
+
+	// the header's count is filled in once it's known
+	string out;
+	size_t total = sizeof(RASTER_CACHE_HEADER);
+	for (auto& x : order) {
+		total += x.first.length() + x.second.extra.length() + (sizeof(uint32) * 2) + (sizeof(int32) * 2) + (size_t(x.second.w) * size_t(x.second.h) * 4);
+	}
+	out.reserve(min<size_t>(total, sizeof(RASTER_CACHE_HEADER) + RASTER_CACHE_MAX_BYTES));
+	out.resize(sizeof(RASTER_CACHE_HEADER));
+	uint32 count = 0;
+	for (auto& x : order) {
+		const auto& e = x.second;
+		const size_t bytes = size_t(e.w) * size_t(e.h) * 4;
+		if (out.length() + bytes > sizeof(RASTER_CACHE_HEADER) + RASTER_CACHE_MAX_BYTES) {
+			continue;
+		}
+		write_string(out, x.first);
+		write_string(out, e.extra);
+		int32 wh[2] = { e.w, e.h };
+		write_value(out, wh, sizeof(wh));
+		write_value(out, e.pixels, bytes);
+		count++;
+	}
+	order.clear();
+	RASTER_CACHE_HEADER hdr = { RASTER_CACHE_MAGIC, RASTER_CACHE_VERSION, hash, count };
+	memcpy(&out[0], &hdr, sizeof(hdr));
+
+	// written next to it and renamed over it, so a crash can't leave half a file and the mapping of the old one stays valid
+	string fn = cache_file();
+	string tmp = fn + ".tmp";
+#ifdef WIN32
+	// rename() won't replace a file here
+	remove(fn.c_str());
+#endif
+	bool ok = (file_put_contents(tmp, out) && rename(tmp.c_str(), fn.c_str()) == 0);
+	{
+		AutoMutex(rasterMutex);
+		saving = false;
+		if (!ok) {
+			dirty = true;
+		}
+	}
+	if (!ok) {
+		printf("Raster cache: error writing %s\n", fn.c_str());
+		remove(tmp.c_str());
+		return;
+	}
+	printf("Raster cache: saved %u entries (%zu KB)\n", count, out.length() / 1024);
+}
+
+void raster_cache_clear() {
+	AutoMutex(rasterMutex);
+	entries.clear();
+	unmap_file();
+	loaded = false;
+	dirty = false;
+}
+
+string raster_cache_stats() {
+	AutoMutex(rasterMutex);
+	return mprintf("Raster cache: %zu entries, %llu hits, %llu misses", entries.size(), (unsigned long long)raster_hits, (unsigned long long)raster_misses);
+}
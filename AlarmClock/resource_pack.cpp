@@ -0,0 +1,530 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2026 Drift Solutions
+
+#include "alarmclock.h"
+#include <atomic>
+#ifndef WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/*
+* The fonts, the menu icons (already decoded) and the list of alarm sounds packed into one file, resources.pak next to
+* the executable, which is mapped at startup. Looking something up is a map lookup into the mapping instead of an
+* open/fstat/mmap per font, a stat and PNG decode per icon and a directory walk for the alarms, which adds up on an SD
+* card. The sounds themselves aren't packed, they're only read when an alarm goes off.
+*
+* Built with: alarm_clock -build_resource_pack (or make resource_pack). Anything that isn't in the pack, or is in a
+* directory that changed since the pack was built, is read from the loose files like before, so resources can still
+* be added or swapped out without rebuilding it. Files edited in place keep their directory's time though, so rebuild
+* the pack after doing that or set resource_pack=0 while working on them.
+*/
+
+#define RESOURCE_PACK_FILE "resources.pak"
+#define RESOURCE_PACK_MAGIC 0x50524341 // "ACRP"
+#define RESOURCE_PACK_VERSION 1
+#define RESOURCE_PACK_ALIGN 16
+
+enum RESOURCE_KIND : uint32 {
+	RK_FILE, // raw file contents
+	RK_IMAGE, // decoded ARGB8888 pixels, straight alpha, w * 4 pitch
+	RK_AUDIO, // only the name, the sound is read from the loose file
+};
+
+struct RESOURCE_PACK_HEADER {
+	uint32 magic;
+	uint32 version;
+	uint32 dir_count;
+	uint32 count;
+};
+
+struct RESOURCE_DIR {
+	int64 mtime = 0; // when the pack was built
+	bool stale = false;
+};
+
+struct RESOURCE_ENTRY {
+	RESOURCE_KIND kind = RK_FILE;
+	int w = 0, h = 0;
+	const uint8* data = NULL;
+	size_t len = 0;
+	string dir;
+};
+
+// The directories that get packed and what's taken from each
+static const struct {
+	const char* dir;
+	RESOURCE_KIND kind;
+	const char* exts;
+} pack_dirs[] = {
+	{ "resources", RK_FILE, "ttf" },
+	{ "resources/images", RK_IMAGE, "png" },
+	{ "resources/alarms", RK_AUDIO, "wav,ogg,mp3,flac,opus" },
+};
+
+static map<string, RESOURCE_DIR> dirs;
+static map<string, RESOURCE_ENTRY> entries;
+static const uint8* pack_data = NULL;
+static size_t pack_len = 0;
+static bool pack_mapped = false;
+static string pack_buf;
+static bool bypass = false; // resource_benchmark() timing the loose files
+static atomic<uint64> pack_hits(0), loose_loads(0);
+
+// What the loose file paths did, for resource_benchmark()
+static atomic<uint64> loose_opens(0), loose_stats(0), loose_dir_entries(0);
+
+static int64 dir_mtime(const string& dir) {
+	struct stat st;
+	if (stat(dir.c_str(), &st) != 0) {
+		return -1;
+	}
+	return (int64)st.st_mtime;
+}
+
+static string parent_dir(const string& fn) {
+	auto p = fn.find_last_of('/');
+	return (p == string::npos) ? "" : fn.substr(0, p);
+}
+
+static bool has_ext(const string& fn, const string& exts) {
+	auto p = fn.find_last_of('.');
+	if (p == string::npos) {
+		return false;
+	}
+	string ext = fn.substr(p + 1);
+	std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+	return ("," + exts + ",").find("," + ext + ",") != string::npos;
+}
+
+static void unmap_pack() {
+#ifndef WIN32
+	if (pack_mapped) {
+		munmap((void*)pack_data, pack_len);
+	}
+#endif
+	pack_mapped = false;
+	pack_data = NULL;
+	pack_len = 0;
+	pack_buf.clear();
+	pack_buf.shrink_to_fit();
+}
+
+static bool map_pack(const string& fn) {
+#ifndef WIN32
+	int fd = open(fn.c_str(), O_RDONLY);
+	if (fd != -1) {
+		struct stat st;
+		if (fstat(fd, &st) == 0 && st.st_size > 0) {
+			void* p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (p != MAP_FAILED) {
+				pack_data = (const uint8*)p;
+				pack_len = st.st_size;
+				pack_mapped = true;
+			}
+		}
+		close(fd);
+	}
+#endif
+
+	if (pack_data == NULL) {
+		if (!file_get_contents(fn, pack_buf) || pack_buf.empty()) {
+			return false;
+		}
+		pack_data = (const uint8*)pack_buf.data();
+		pack_len = pack_buf.length();
+	}
+	return true;
+}
+
+template<typename T> static bool read_value(size_t& pos, T& val) {
+	if (pack_len - pos < sizeof(T)) {
+		return false;
+	}
+	memcpy(&val, pack_data + pos, sizeof(T));
+	pos += sizeof(T);
+	return true;
+}
+
+static bool read_string(size_t& pos, string& str) {
+	uint32 len = 0;
+	if (!read_value(pos, len) || pack_len - pos < len) {
+		return false;
+	}
+	str.assign((const char*)pack_data + pos, len);
+	pos += len;
+	return true;
+}
+
+void resource_pack_open() {
+	Uint64 start = SDL_GetTicks64();
+	if (access(RESOURCE_PACK_FILE, 0) != 0) {
+		printf("Resource pack: " RESOURCE_PACK_FILE " doesn't exist, using the loose files (build it with -build_resource_pack)\n");
+		return;
+	}
+	if (!map_pack(RESOURCE_PACK_FILE)) {
+		printf("Resource pack: error reading " RESOURCE_PACK_FILE ", using the loose files\n");
+		return;
+	}
+
+	size_t pos = 0;
+	RESOURCE_PACK_HEADER hdr;
+	if (!read_value(pos, hdr) || hdr.magic != RESOURCE_PACK_MAGIC || hdr.version != RESOURCE_PACK_VERSION) {
+		printf("Resource pack: " RESOURCE_PACK_FILE " isn't a resource pack or is from another version, using the loose files\n");
+		unmap_pack();
+		return;
+	}
+
+	bool ok = true;
+	for (uint32 i = 0; i < hdr.dir_count && ok; i++) {
+		string name;
+		RESOURCE_DIR d;
+		ok = read_string(pos, name) && read_value(pos, d.mtime);
+		if (ok) {
+			// one stat per directory tells us if anything was added, removed or replaced since the pack was built
+			d.stale = (dir_mtime(name) != d.mtime);
+			if (d.stale) {
+				printf("Resource pack: %s changed since " RESOURCE_PACK_FILE " was built, using the loose files in it\n", name.c_str());
+			}
+			dirs[name] = d;
+		}
+	}
+	for (uint32 i = 0; i < hdr.count && ok; i++) {
+		string name;
+		RESOURCE_ENTRY e;
+		uint32 kind = 0;
+		int32 wh[2];
+		uint64 offset = 0, len = 0;
+		ok = read_string(pos, name) && read_value(pos, kind) && read_value(pos, wh) && read_value(pos, offset) && read_value(pos, len);
+		if (ok && (offset > pack_len || len > pack_len - offset)) {
+			ok = false;
+		}
+		if (ok) {
+			e.kind = (RESOURCE_KIND)kind;
+			e.w = wh[0];
+			e.h = wh[1];
+			e.data = pack_data + offset;
+			e.len = (size_t)len;
+			e.dir = parent_dir(name);
+			entries[name] = e;
+		}
+	}
+	if (!ok) {
+		printf("Resource pack: " RESOURCE_PACK_FILE " is damaged, using the loose files\n");
+		resource_pack_close();
+		return;
+	}
+
+	printf("Resource pack: mapped %zu entries (%zu KB) in %llums\n", entries.size(), pack_len / 1024, (unsigned long long)(SDL_GetTicks64() - start));
+}
+
+void resource_pack_close() {
+	entries.clear();
+	dirs.clear();
+	unmap_pack();
+}
+
+static const RESOURCE_ENTRY* find_entry(const string& name, RESOURCE_KIND kind) {
+	if (bypass) {
+		return NULL;
+	}
+	auto x = entries.find(name);
+	if (x == entries.end() || x->second.kind != kind) {
+		return NULL;
+	}
+	auto d = dirs.find(x->second.dir);
+	if (d == dirs.end() || d->second.stale) {
+		return NULL;
+	}
+	return &x->second;
+}
+
+bool resource_pack_find(const string& fn, const uint8*& data, size_t& len) {
+	auto e = find_entry(fn, RK_FILE);
+	if (e == NULL) {
+		loose_opens++;
+		loose_loads++;
+		return false;
+	}
+	data = e->data;
+	len = e->len;
+	pack_hits++;
+	return true;
+}
+
+SDL_Surface* resource_load_image(const string& fn) {
+	auto e = find_entry(fn, RK_IMAGE);
+	if (e != NULL && e->len == size_t(e->w) * size_t(e->h) * 4) {
+		SDL_Surface* ret = SDL_CreateRGBSurfaceWithFormat(0, e->w, e->h, 32, SDL_PIXELFORMAT_ARGB8888);
+		if (ret != NULL) {
+			for (int y = 0; y < e->h; y++) {
+				memcpy((uint8*)ret->pixels + (size_t(y) * ret->pitch), e->data + (size_t(y) * e->w * 4), size_t(e->w) * 4);
+			}
+			pack_hits++;
+			return ret;
+		}
+	}
+
+	loose_loads++;
+	// decoded pixels are kept in the raster cache, keyed by the file's size and time so an edited icon is decoded again
+	string rkey;
+	struct stat st;
+	loose_stats++;
+	if (stat(fn.c_str(), &st) == 0) {
+		rkey = mprintf("image:%s:%lld:%lld", fn.c_str(), (long long)st.st_size, (long long)st.st_mtime);
+	}
+	auto src = rkey.length() ? raster_cache_get(rkey) : NULL;
+	if (src == NULL) {
+		loose_opens++;
+		src = IMG_Load(fn.c_str());
+		if (src != NULL && rkey.length()) {
+			raster_cache_put(rkey, src);
+		}
+	}
+	return src;
+}
+
+static bool list_loose(const string& dir, vector<string>& files) {
+	Directory d;
+	if (!d.Open(dir.c_str())) {
+		return false;
+	}
+	loose_opens++;
+	char buf[MAX_PATH];
+	bool is_dir;
+	while (d.Read(buf, sizeof(buf), &is_dir)) {
+		loose_dir_entries++;
+		if (buf[0] == '.' || is_dir) { continue; }
+		// '/' on every platform so the names match the pack's
+		files.push_back(dir + "/" + buf);
+	}
+	return true;
+}
+
+bool resource_list(const string& dir, vector<string>& files) {
+	files.clear();
+	auto d = dirs.find(dir);
+	if (!bypass && d != dirs.end() && !d->second.stale) {
+		for (auto& x : entries) {
+			if (x.second.dir == dir) {
+				files.push_back(x.first);
+			}
+		}
+		pack_hits++;
+		return true;
+	}
+	loose_loads++;
+	return list_loose(dir, files);
+}
+
+static void write_value(string& out, const void* p, size_t len) {
+	out.append((const char*)p, len);
+}
+
+static void write_string(string& out, const string& str) {
+	uint32 len = (uint32)str.length();
+	write_value(out, &len, sizeof(len));
+	out += str;
+}
+
+bool resource_pack_build() {
+	struct PACK_ITEM {
+		string name;
+		RESOURCE_KIND kind;
+		int32 w = 0, h = 0;
+		string data;
+	};
+	vector<PACK_ITEM> items;
+	vector<pair<string, int64>> packed_dirs;
+
+	for (auto& pd : pack_dirs) {
+		int64 mtime = dir_mtime(pd.dir);
+		vector<string> files;
+		if (mtime == -1 || !list_loose(pd.dir, files)) {
+			printf("Resource pack: error reading %s, it won't be packed\n", pd.dir);
+			continue;
+		}
+		sort(files.begin(), files.end());
+		for (auto& fn : files) {
+			if (!has_ext(fn, pd.exts)) {
+				continue;
+			}
+			PACK_ITEM item;
+			item.name = fn;
+			item.kind = pd.kind;
+			if (pd.kind == RK_FILE) {
+				if (!file_get_contents(fn, item.data) || item.data.empty()) {
+					printf("Resource pack: error reading %s\n", fn.c_str());
+					return false;
+				}
+			} else if (pd.kind == RK_IMAGE) {
+				SDL_Surface* src = IMG_Load(fn.c_str());
+				SDL_Surface* conv = (src != NULL) ? SDL_ConvertSurfaceFormat(src, SDL_PIXELFORMAT_ARGB8888, 0) : NULL;
+				if (conv == NULL) {
+					printf("Resource pack: error decoding %s: %s\n", fn.c_str(), IMG_GetError());
+					if (src != NULL) {
+						SDL_FreeSurface(src);
+					}
+					return false;
+				}
+				item.w = conv->w;
+				item.h = conv->h;
+				for (int y = 0; y < conv->h; y++) {
+					item.data.append((const char*)conv->pixels + (size_t(y) * conv->pitch), size_t(conv->w) * 4);
+				}
+				SDL_FreeSurface(conv);
+				SDL_FreeSurface(src);
+			}
+			items.push_back(std::move(item));
+		}
+		packed_dirs.push_back({ pd.dir, mtime });
+	}
+
+	// the index comes first so opening the pack only touches its first pages, the data follows it aligned
+	string index;
+	for (auto& d : packed_dirs) {
+		write_string(index, d.first);
+		write_value(index, &d.second, sizeof(d.second));
+	}
+	size_t index_len = sizeof(RESOURCE_PACK_HEADER) + index.length();
+	for (auto& item : items) {
+		index_len += sizeof(uint32) + item.name.length() + sizeof(uint32) + (sizeof(int32) * 2) + (sizeof(uint64) * 2);
+	}
+
+	const size_t data_start = (index_len + RESOURCE_PACK_ALIGN - 1) & ~size_t(RESOURCE_PACK_ALIGN - 1);
+	string body;
+	for (auto& item : items) {
+		uint64 len = item.data.length();
+		uint64 offset = len ? data_start + body.length() : 0;
+		write_string(index, item.name);
+		uint32 kind = item.kind;
+		write_value(index, &kind, sizeof(kind));
+		int32 wh[2] = { item.w, item.h };
+		write_value(index, wh, sizeof(wh));
+		write_value(index, &offset, sizeof(offset));
+		write_value(index, &len, sizeof(len));
+		body += item.data;
+		body.resize((body.length() + RESOURCE_PACK_ALIGN - 1) & ~size_t(RESOURCE_PACK_ALIGN - 1));
+	}
+
+	RESOURCE_PACK_HEADER hdr = { RESOURCE_PACK_MAGIC, RESOURCE_PACK_VERSION, (uint32)packed_dirs.size(), (uint32)items.size() };
+	string out;
+	write_value(out, &hdr, sizeof(hdr));
+	out += index;
+	out.resize(data_start);
+	out += body;
+
+	// a running clock may have the old one mapped, so it's replaced instead of written over
+	string tmp = RESOURCE_PACK_FILE ".tmp";
+#ifdef WIN32
+	remove(RESOURCE_PACK_FILE);
+#endif
+	if (!file_put_contents(tmp, out) || rename(tmp.c_str(), RESOURCE_PACK_FILE) != 0) {
+		printf("Resource pack: error writing " RESOURCE_PACK_FILE "\n");
+		remove(tmp.c_str());
+		return false;
+	}
+	printf("Resource pack: wrote %zu entries from %zu directories to " RESOURCE_PACK_FILE " (%zu KB)\n", items.size(), packed_dirs.size(), out.length() / 1024);
+	return true;
+}
+
+string resource_pack_stats() {
+	if (pack_data == NULL) {
+		return mprintf("Resource pack: not loaded, %llu loose loads", (unsigned long long)loose_loads);
+	}
+	size_t stale = 0;
+	for (auto& d : dirs) {
+		if (d.second.stale) {
+			stale++;
+		}
+	}
+	return mprintf("Resource pack: %zu entries (%zu KB, %s), %zu of %zu directories stale, %llu hits, %llu loose loads", entries.size(), pack_len / 1024, pack_mapped ? "mapped" : "in memory", stale, dirs.size(), (unsigned long long)pack_hits, (unsigned long long)loose_loads);
+}
+
+/*
+* Startup resource loading with and without the pack: both fonts opened at one size, every menu icon loaded and the
+* alarm sounds listed. Read syscalls and bytes come from /proc/self/io, so they include whatever SDL_image and
+* file_get_contents() do under us. Reads through a mapping are page faults and don't show up there, which is the point.
+* The first round is the only one that might be cold; for really cold numbers drop the page cache between runs
+* (echo 3 > /proc/sys/vm/drop_caches) or run it under strace -c -f.
+*/
+struct IO_COUNTERS {
+	uint64 syscr = 0;
+	uint64 rchar = 0;
+};
+
+static IO_COUNTERS read_io_counters() {
+	IO_COUNTERS ret;
+#ifndef WIN32
+	FILE* fp = fopen("/proc/self/io", "rb");
+	if (fp != NULL) {
+		char line[128];
+		while (fgets(line, sizeof(line), fp) != NULL) {
+			unsigned long long val = 0;
+			if (sscanf(line, "syscr: %llu", &val) == 1) {
+				ret.syscr = val;
+			} else if (sscanf(line, "rchar: %llu", &val) == 1) {
+				ret.rchar = val;
+			}
+		}
+		fclose(fp);
+	}
+#endif
+	return ret;
+}
+
+static void load_startup_resources() {
+	FontFile regular("resources/roboto.ttf"), mono("resources/roboto_mono.ttf");
+	TTF_Font* f = regular.OpenPrivate(14);
+	if (f != NULL) {
+		ClosePrivateFont(f);
+	}
+	f = mono.OpenPrivate(14);
+	if (f != NULL) {
+		ClosePrivateFont(f);
+	}
+	regular.Reset();
+	mono.Reset();
+
+	vector<string> files;
+	resource_list("resources/images", files);
+	for (auto& fn : files) {
+		auto src = resource_load_image(fn);
+		if (src != NULL) {
+			SDL_FreeSurface(src);
+		}
+	}
+	resource_list("resources/alarms", files);
+}
+
+void resource_benchmark(int rounds) {
+	if (pack_data == NULL) {
+		printf("Resource benchmark: there's no resource pack loaded, build it with -build_resource_pack first\n");
+		return;
+	}
+
+	printf("Resource benchmark: %d rounds each of loose files and the pack...\n", rounds);
+	for (int pass = 0; pass < 2; pass++) {
+		bypass = (pass == 0);
+		Uint64 total = 0, worst = 0;
+		IO_COUNTERS before = read_io_counters();
+		uint64 opens = loose_opens, stats = loose_stats, dir_entries = loose_dir_entries;
+		for (int i = 0; i < rounds; i++) {
+			Uint64 start = SDL_GetPerformanceCounter();
+			load_startup_resources();
+			Uint64 ticks = SDL_GetPerformanceCounter() - start;
+			total += ticks;
+			worst = max(worst, ticks);
+		}
+		IO_COUNTERS after = read_io_counters();
+		const double freq = double(SDL_GetPerformanceFrequency()) / 1000.0;
+		printf("%s: %.3f ms avg, %.3f ms worst; per round %.1f read syscalls, %.1f KB read, %.1f opens, %.1f stats, %.1f directory entries\n",
+			bypass ? "Loose files" : "Resource pack",
+			double(total) / freq / rounds, double(worst) / freq,
+			double(after.syscr - before.syscr) / rounds, double(after.rchar - before.rchar) / 1024.0 / rounds,
+			double(loose_opens - opens) / rounds, double(loose_stats - stats) / rounds, double(loose_dir_entries - dir_entries) / rounds);
+	}
+	bypass = false;
+}
@@ -0,0 +1,216 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2026 Drift Solutions
+
+#include "alarmclock.h"
+
+// Past this many separate rects it's cheaper to redraw their bounding box than to walk the nodes for each one
+#define SCENE_MAX_DAMAGE_RECTS 8
+
+/*
+* One backbuffer shared by every scene. It holds whatever the last scene to render left in it, so a scene that isn't
+* the owner has to redraw everything.
+*/
+static SDL_Texture* backbuffer = NULL;
+static SDL_Size backbuffer_size = { 0, 0 };
+static uint32 backbuffer_owner = 0;
+static bool backbuffer_failed = false;
+static uint32 next_scene_id = 1;
+static uint64 scene_frames = 0, scene_idle_frames = 0, scene_full_frames = 0, scene_damaged_pixels = 0, scene_total_pixels = 0, scene_node_draws = 0;
+
+static bool ensure_backbuffer() {
+	if (backbuffer_failed) {
+		return false;
+	}
+	if (backbuffer != NULL && (backbuffer_size.w != config.win_size.w || backbuffer_size.h != config.win_size.h)) {
+		scene_backbuffer_free();
+	}
+	if (backbuffer == NULL) {
+		if (!SDL_RenderTargetSupported(config.mRenderer)) {
+			backbuffer_failed = true;
+			return false;
+		}
+		backbuffer = texture_create(TO_BACKBUFFER, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, config.win_size.w, config.win_size.h);
+		if (backbuffer == NULL) {
+			printf("Error creating scene backbuffer: %s\n", SDL_GetError());
+			backbuffer_failed = true;
+			return false;
+		}
+		// copied over the whole screen, no need to blend it with what's there
+		SDL_SetTextureBlendMode(backbuffer, SDL_BLENDMODE_NONE);
+		backbuffer_size = config.win_size;
+		backbuffer_owner = 0;
+	}
+	return true;
+}
+
+void scene_backbuffer_reset() {
+	backbuffer_owner = 0;
+}
+
+void scene_backbuffer_free() {
+	if (backbuffer != NULL) {
+		texture_destroy(backbuffer);
+		backbuffer = NULL;
+	}
+	backbuffer_owner = 0;
+}
+
+string scene_stats() {
+	double per = scene_total_pixels ? double(scene_damaged_pixels) * 100.0 / double(scene_total_pixels) : 0.0;
+	return mprintf("Scene: %llu frames (%llu with no damage, %llu full redraws), %.1f%% of pixels redrawn, %llu node draws", (unsigned long long)scene_frames, (unsigned long long)scene_idle_frames, (unsigned long long)scene_full_frames, per, (unsigned long long)scene_node_draws);
+}
+
+static bool rect_empty(const SDL_Rect& rc) {
+	return (rc.w <= 0 || rc.h <= 0);
+}
+
+Scene::Scene() {
+	id = next_scene_id++;
+}
+
+void Scene::Add(shared_ptr<SceneNode> node) {
+	nodes.push_back(node);
+	DamageAll();
+}
+
+void Scene::Clear() {
+	nodes.clear();
+	DamageAll();
+}
+
+void Scene::DamageAll() {
+	// the next Render() will see it doesn't own the backbuffer
+	if (backbuffer_owner == id) {
+		backbuffer_owner = 0;
+	}
+	request_redraw();
+}
+
+void Scene::addDamage(const SDL_Rect& rc) {
+	SDL_Rect screen = { 0, 0, backbuffer_size.w, backbuffer_size.h };
+	SDL_Rect clipped;
+	if (!rect_empty(rc) && SDL_IntersectRect(&rc, &screen, &clipped)) {
+		damage.push_back(clipped);
+	}
+}
+
+// Overlapping rects would get drawn twice, so they're joined first
+void Scene::mergeDamage() {
+	bool merged = true;
+	while (merged) {
+		merged = false;
+		for (size_t i = 0; i < damage.size() && !merged; i++) {
+			for (size_t j = i + 1; j < damage.size(); j++) {
+				if (SDL_HasIntersection(&damage[i], &damage[j])) {
+					SDL_UnionRect(&damage[i], &damage[j], &damage[i]);
+					damage.erase(damage.begin() + j);
+					merged = true;
+					break;
+				}
+			}
+		}
+	}
+
+	if (damage.size() > SCENE_MAX_DAMAGE_RECTS) {
+		SDL_Rect all = damage[0];
+		for (auto& rc : damage) {
+			SDL_UnionRect(&all, &rc, &all);
+		}
+		damage.clear();
+		damage.push_back(all);
+	}
+}
+
+bool Scene::Render() {
+	if (!ensure_backbuffer()) {
+		return false;
+	}
+
+	const bool full = (backbuffer_owner != id);
+	damage.clear();
+	if (full) {
+		damage.push_back({ 0, 0, backbuffer_size.w, backbuffer_size.h });
+	}
+
+	for (auto& n : nodes) {
+		string state;
+		SDL_Rect bounds = { 0 };
+		bool cacheable = true;
+		if (n->visible) {
+			n->Prepare();
+			cacheable = n->GetState(state);
+			bounds = n->GetBounds();
+		}
+		if (!full && (n->dirty || !cacheable || state != n->last_state || memcmp(&bounds, &n->last_bounds, sizeof(SDL_Rect)))) {
+			addDamage(n->last_bounds);
+			addDamage(bounds);
+		}
+		n->dirty = !cacheable;
+		n->last_state = std::move(state);
+		n->last_bounds = bounds;
+	}
+	mergeDamage();
+
+	scene_frames++;
+	scene_total_pixels += (uint64)backbuffer_size.w * (uint64)backbuffer_size.h;
+	if (full) {
+		scene_full_frames++;
+	}
+	if (damage.size() == 0) {
+		scene_idle_frames++;
+	} else {
+		if (SDL_SetRenderTarget(config.mRenderer, backbuffer) != 0) {
+			printf("Error setting scene backbuffer as render target: %s\n", SDL_GetError());
+			scene_backbuffer_free();
+			backbuffer_failed = true;
+			return false;
+		}
+		backbuffer_owner = id;
+
+		SDL_BlendMode blend = SDL_BLENDMODE_NONE;
+		SDL_GetRenderDrawBlendMode(config.mRenderer, &blend);
+		for (auto& rc : damage) {
+			scene_damaged_pixels += (uint64)rc.w * (uint64)rc.h;
+			// the last rect's sprites go out with its clip
+			batch_flush(false);
+			SDL_RenderSetClipRect(config.mRenderer, &rc);
+			// SDL_RenderClear() ignores the clip rect
+			SDL_SetRenderDrawBlendMode(config.mRenderer, SDL_BLENDMODE_NONE);
+			SDL_SetRenderDrawColor(config.mRenderer, bg);
+			SDL_RenderFillRect(config.mRenderer, &rc);
+			SDL_SetRenderDrawBlendMode(config.mRenderer, blend);
+
+			for (auto& n : nodes) {
+				if (!n->visible || !SDL_HasIntersection(&rc, &n->last_bounds)) {
+					continue;
+				}
+				uint64 pending = text_async_pending_draws();
+				n->Draw();
+				scene_node_draws++;
+				if (text_async_pending_draws() != pending) {
+					// some of its text is still on the text worker, it'll request a redraw when it's done
+					n->dirty = true;
+				}
+			}
+		}
+
+		batch_flush(false);
+		SDL_RenderSetClipRect(config.mRenderer, NULL);
+		SDL_SetRenderTarget(config.mRenderer, NULL);
+	}
+
+	SDL_Rect rc = { 0, 0, backbuffer_size.w, backbuffer_size.h };
+	SDL_RenderCopy(config.mRenderer, backbuffer, NULL, &rc);
+	return true;
+}
+
+void Scene::Draw() {
+	SDL_SetRenderDrawColor(config.mRenderer, bg);
+	SDL_RenderClear(config.mRenderer);
+	for (auto& n : nodes) {
+		if (n->visible) {
+			n->Prepare();
+			n->Draw();
+		}
+	}
+}
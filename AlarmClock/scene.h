@@ -0,0 +1,76 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2026 Drift Solutions
+
+#pragma once
+
+/*
+* Retained scene for a page: a list of nodes drawn back to front. Each frame the scene asks every node for its state
+* and bounds, and only the areas whose nodes changed are redrawn into a persistent backbuffer, which is then copied to
+* the screen. Nodes draw in screen coordinates and have to stay inside GetBounds(), the compositor clips to the damage.
+*/
+class SceneNode {
+private:
+	friend class Scene;
+	bool dirty = true;
+	string last_state;
+	SDL_Rect last_bounds = { 0 };
+public:
+	bool visible = true; // hidden nodes aren't drawn and the area they covered gets redrawn
+
+	virtual void Prepare() {} // refresh cached textures before the state is taken, never called with a target texture set
+	virtual bool GetState(string& state) = 0; // appends everything Draw() output depends on, returns false if it needs to be drawn every frame anyway
+	virtual SDL_Rect GetBounds() = 0; // the area Draw() covers right now
+	virtual void Draw() = 0;
+
+	void Invalidate() {
+		dirty = true;
+		request_redraw();
+	}
+
+	virtual ~SceneNode() {}
+};
+
+// A CachedText as a node, bounded by the text itself rather than the whole rect it's aligned in
+class SceneTextNode : public SceneNode {
+public:
+	CachedText txt;
+
+	void Prepare() {
+		txt.Update();
+	}
+	bool GetState(string& state) {
+		txt.GetState(state);
+		return true;
+	}
+	SDL_Rect GetBounds() {
+		return txt.GetBounds();
+	}
+	void Draw() {
+		txt.Draw();
+	}
+};
+
+class Scene {
+private:
+	uint32 id = 0;
+	vector<shared_ptr<SceneNode>> nodes;
+	vector<SDL_Rect> damage;
+
+	void addDamage(const SDL_Rect& rc);
+	void mergeDamage();
+public:
+	SDL_Color bg = { 0, 0, 0, 0xFF }; // what damaged areas are cleared to before the nodes are drawn
+
+	Scene();
+
+	void Add(shared_ptr<SceneNode> node);
+	void Clear();
+	void DamageAll();
+
+	bool Render(); // composites damaged areas into the backbuffer and copies it to the screen, returns false if the page has to be drawn with Draw() instead
+	void Draw(); // clears the current target to bg and draws every visible node straight to it
+};
+
+void scene_backbuffer_reset(); // the backbuffer's contents are gone, every scene redraws in full
+void scene_backbuffer_free();
+string scene_stats();
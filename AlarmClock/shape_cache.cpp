@@ -0,0 +1,174 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2026 Drift Solutions
+
+#include "alarmclock.h"
+
+/*
+* Rounded boxes and outlines drawn from cached nine-slice sprites. Each shape is rendered once with SDL2_gfx into a
+* small (2 * radius + 3) square: the corners are copied as-is and the 1 pixel wide edges/center get stretched to size.
+* A shape is then nine quads in the sprite batch (usually on the same atlas page as the text around it) instead of the
+* dozens of lines and points SDL2_gfx breaks it down into every frame. The sprites are white and get tinted when drawn,
+* so one sprite covers every color.
+*/
+
+struct SHAPE_KEY {
+	int radius;
+	bool outline;
+
+	bool operator<(const SHAPE_KEY& b) const {
+		if (radius != b.radius) {
+			return radius < b.radius;
+		}
+		return outline < b.outline;
+	}
+};
+
+struct SHAPE_SPRITE {
+	SPRITE spr;
+	int size = 0;
+};
+
+static map<SHAPE_KEY, SHAPE_SPRITE> shapes;
+static uint64 shape_draws = 0, shape_fallbacks = 0;
+
+static SHAPE_SPRITE* get_shape(int rad, bool outline) {
+	SHAPE_KEY key = { rad, outline };
+	auto x = shapes.find(key);
+	if (x != shapes.end()) {
+		return &x->second;
+	}
+
+	SHAPE_SPRITE ret;
+	ret.size = (rad * 2) + 3;
+	auto surface = SDL_CreateRGBSurfaceWithFormat(0, ret.size, ret.size, 32, SDL_PIXELFORMAT_RGBA32);
+	if (surface == NULL) {
+		return NULL;
+	}
+	auto sw = SDL_CreateSoftwareRenderer(surface);
+	if (sw != NULL) {
+		SDL_SetRenderDrawColor(sw, 0, 0, 0, 0);
+		SDL_RenderClear(sw);
+		// drawn opaque so the edge pixels don't get blended with the transparent background
+		const int edge = ret.size - 1;
+		if (outline) {
+			roundedRectangleRGBA(sw, 0, 0, edge, edge, rad, 0xFF, 0xFF, 0xFF, 0xFF);
+		} else {
+			roundedBoxRGBA(sw, 0, 0, edge, edge, rad, 0xFF, 0xFF, 0xFF, 0xFF);
+		}
+		SDL_RenderFlush(sw);
+		SDL_DestroyRenderer(sw);
+
+		sprite_create(surface, ret.spr, TO_SHAPES);
+	}
+	SDL_FreeSurface(surface);
+
+	if (ret.spr.tex == NULL) {
+		printf("Error creating shape sprite for radius %d: %s\n", rad, SDL_GetError());
+		return NULL;
+	}
+	return &(shapes[key] = ret);
+}
+
+static void draw_nine_slice(SHAPE_SPRITE* s, const SDL_Rect& rc, const SDL_Color& col) {
+	// same coverage as SDL2_gfx: x2/y2 are inclusive
+	const int w = rc.w + 1, h = rc.h + 1;
+	const int c = (s->size - 1) / 2; // corner size, the center is the 1 pixel left over
+	const int xs[4] = { rc.x, rc.x + c, rc.x + w - c, rc.x + w };
+	const int ys[4] = { rc.y, rc.y + c, rc.y + h - c, rc.y + h };
+	const int us[4] = { 0, c, s->size - c, s->size };
+
+	for (int row = 0; row < 3; row++) {
+		for (int col_ind = 0; col_ind < 3; col_ind++) {
+			SDL_Rect src = { us[col_ind], us[row], us[col_ind + 1] - us[col_ind], us[row + 1] - us[row] };
+			SDL_Rect dest = { xs[col_ind], ys[row], xs[col_ind + 1] - xs[col_ind], ys[row + 1] - ys[row] };
+			draw_sprite_part(s->spr, src, dest, col);
+		}
+	}
+}
+
+static void draw_rounded(const SDL_Rect& rc, int rad, const SDL_Color& col, bool outline) {
+	shape_draws++;
+	// too small to have a middle to stretch, SDL2_gfx clamps the radius for these
+	SHAPE_SPRITE* s = NULL;
+	if (rad >= 1 && rc.w >= rad * 2 && rc.h >= rad * 2) {
+		s = get_shape(rad, outline);
+	}
+	if (s != NULL) {
+		draw_nine_slice(s, rc, col);
+		return;
+	}
+
+	shape_fallbacks++;
+	batch_flush();
+	if (outline) {
+		roundedRectangleRGBA(config.mRenderer, rc.x, rc.y, rc.x + rc.w, rc.y + rc.h, rad, col.r, col.g, col.b, col.a);
+	} else {
+		roundedBoxRGBA(config.mRenderer, rc.x, rc.y, rc.x + rc.w, rc.y + rc.h, rad, col.r, col.g, col.b, col.a);
+	}
+}
+
+void draw_rounded_box(const SDL_Rect& rc, int rad, const SDL_Color& col) {
+	draw_rounded(rc, rad, col, false);
+}
+
+void draw_rounded_rect(const SDL_Rect& rc, int rad, const SDL_Color& col) {
+	draw_rounded(rc, rad, col, true);
+}
+
+void shape_cache_clear() {
+	for (auto& x : shapes) {
+		sprite_free(x.second.spr);
+	}
+	shapes.clear();
+}
+
+string shape_cache_stats() {
+	return mprintf("Shape cache: %zu sprites, %llu shapes drawn, %llu fell back to SDL2_gfx", shapes.size(), (unsigned long long)shape_draws, (unsigned long long)shape_fallbacks);
+}
+
+/*
+* -benchmark=shapes: draws a page of filled and outlined menu buttons, first with SDL2_gfx and then from the cache,
+* and prints the average frame time for each. SDL2_gfx's own line/point calls can't be counted from out here, so only
+* the cache side reports draw calls (from the sprite batch).
+*/
+void shape_benchmark(int frames) {
+	auto draw_page = [](bool cached) {
+		const SDL_Color bg = colors.menu_normal_bg;
+		const SDL_Color border = colors.clock_text;
+		const int rad = 10;
+		for (auto& b : config.menu_buttons.buttons) {
+			if (cached) {
+				draw_rounded_box(b, rad, bg);
+				draw_rounded_rect(b, rad, border);
+			} else {
+				roundedBoxRGBA(config.mRenderer, b.x, b.y, b.x + b.w, b.y + b.h, rad, bg.r, bg.g, bg.b, bg.a);
+				roundedRectangleRGBA(config.mRenderer, b.x, b.y, b.x + b.w, b.y + b.h, rad, border.r, border.g, border.b, border.a);
+			}
+		}
+	};
+
+	const int shapes_per_frame = (int)(sizeof(config.menu_buttons.buttons) / sizeof(config.menu_buttons.buttons[0])) * 2;
+	Uint64 freq = SDL_GetPerformanceFrequency();
+	for (int pass = 0; pass < 2; pass++) {
+		const bool cached = (pass == 1);
+		// warm up, creates the cache textures on the cached pass
+		draw_page(cached);
+
+		uint64 calls_before = batch_totals().draw_calls;
+		Uint64 start = SDL_GetPerformanceCounter();
+		for (int i = 0; i < frames; i++) {
+			SDL_SetRenderDrawColor(config.mRenderer, colors.menu_page_bg);
+			SDL_RenderClear(config.mRenderer);
+			batch_begin();
+			draw_page(cached);
+			batch_end();
+			SDL_RenderPresent(config.mRenderer);
+		}
+		double ms = double(SDL_GetPerformanceCounter() - start) * 1000.0 / double(freq) / double(frames);
+		if (cached) {
+			printf("Shapes (cache):   %d shapes/frame, %.1f draw calls/frame, %.3f ms/frame\n", shapes_per_frame, double(batch_totals().draw_calls - calls_before) / double(frames), ms);
+		} else {
+			printf("Shapes (SDL2_gfx): %d shapes/frame, %.3f ms/frame\n", shapes_per_frame, ms);
+		}
+	}
+}
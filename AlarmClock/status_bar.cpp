@@ -36,17 +36,52 @@ void SDL_StatusBarSection::SetSizingFixed(int width) {
 	}
 }
 
+void SDL_StatusBarSection::clearCachedSprite() {
+	text_async_cancel(ticket);
+	ticket = 0;
+	spr_stale = false;
+	sprite_free(spr);
+}
+
 void SDL_StatusBarSection::SetText(const string& str) {
 	if (str != text) {
 		_text = str;
-		clearCachedTexture();
+		// the old text stays up until Draw() has the new one
+		text_async_cancel(ticket);
+		ticket = 0;
+		spr_stale = true;
+		request_redraw();
+	}
+}
+void SDL_StatusBarSection::Update() {
+	if (text.empty()) {
+		clearCachedSprite();
+		return;
 	}
+
+	SDL_Rect clip_rc = { rc.x + 3, rc.y + 2, rc.w - 6, rc.h - 4 };
+
+	if (spr.tex == NULL || spr_stale) {
+		TEXT_JOB job;
+		job.type = TJ_FIXED;
+		job.ptSize = text_fit_size(text, STATUS_FONT_SIZE, { clip_rc.w, clip_rc.h }, TTF_STYLE_NORMAL, TFF_WIDTH);
+		job.rc = clip_rc;
+		job.str = text;
+		if (text_sprite_update(ticket, job, spr)) {
+			spr_stale = false;
+		}
+	}
+}
+
+void SDL_StatusBarSection::GetState(string& state) {
+	state += mprintf("%d,%d,%d,%d|%d|%zu/%zu|%p,%d,%d,%d,%d|", rc.x, rc.y, rc.w, rc.h, align, progress_current, progress_max, spr.tex, spr.rc.x, spr.rc.y, spr.rc.w, spr.rc.h);
+	state += text;
+	state += '\0';
 }
+
 void SDL_StatusBarSection::Draw() {
-	SDL_SetRenderDrawColor(config.mRenderer, colors.menu_normal_bg.r, colors.menu_normal_bg.g, colors.menu_normal_bg.b, SDL_ALPHA_OPAQUE);
-	SDL_RenderFillRect(config.mRenderer, &rc);
-	SDL_SetRenderDrawColor(config.mRenderer, colors.menu_frame.r, colors.menu_frame.g, colors.menu_frame.b, SDL_ALPHA_OPAQUE);
-	SDL_RenderDrawRect(config.mRenderer, &rc);
+	draw_fill(rc, { colors.menu_normal_bg.r, colors.menu_normal_bg.g, colors.menu_normal_bg.b, SDL_ALPHA_OPAQUE });
+	draw_outline(rc, { colors.menu_frame.r, colors.menu_frame.g, colors.menu_frame.b, SDL_ALPHA_OPAQUE });
 	/*
 	SDL_SetRenderDrawColor(config.mRenderer, 0x33, 0x33, 0x33, SDL_ALPHA_OPAQUE);
 	SDL_RenderDrawLine(config.mRenderer, rc.x, rc.y, rc.x + rc.w, rc.y);
@@ -63,58 +98,26 @@ void SDL_StatusBarSection::Draw() {
 			rc.x + 3, rc.y + 3,
 			int(per * double(rc.w - 5)), rc.h - 5
 		};
-		SDL_SetRenderDrawColor(config.mRenderer, colors.menu_highlight_bg.r, colors.menu_highlight_bg.g, colors.menu_highlight_bg.b, SDL_ALPHA_OPAQUE);
-		SDL_RenderFillRect(config.mRenderer, &prc);
+		draw_fill(prc, { colors.menu_highlight_bg.r, colors.menu_highlight_bg.g, colors.menu_highlight_bg.b, SDL_ALPHA_OPAQUE });
 	}
 
 	if (text.empty()) { return; }
 
+	Update();
 	SDL_Rect clip_rc = { rc.x + 3, rc.y + 2, rc.w - 6, rc.h - 4 };
-
-	if (tex == NULL) {
-		int w = INT_MAX;
-		int ptsize = STATUS_FONT_SIZE;
-		do {
-			if (tex != NULL) {
-				SDL_DestroyTexture(tex);
-				tex = NULL;
-			}
-			auto font = GetFontSize(ptsize);
-			auto src = TTF_RenderUTF8_Blended(font, text.c_str(), colors.menu_normal_text);
-			if (src != NULL) {
-				w = src->w;
-				tex = SDL_CreateTextureFromSurface(config.mRenderer, src);
-				tex_size = { src->w, src->h };
-				SDL_FreeSurface(src);
-				//TTF_SetFontSize
-			}
-		} while (w > clip_rc.w && ptsize-- > 10);
-	}
-
-	if (tex != NULL) {
-		SDL_Rect orig_clip;
-		SDL_RenderGetClipRect(config.mRenderer, &orig_clip);
-		SDL_RenderSetClipRect(config.mRenderer, &clip_rc);
-
-		SDL_Rect trc = { 0, 0, tex_size.w, tex_size.h };
+	if (spr.tex != NULL) {
 		SDL_Rect drc;
 		if (align == SBA_LEFT) {
-			drc = { clip_rc.x, clip_rc.y, trc.w, trc.h };
+			drc = { clip_rc.x, clip_rc.y, spr.rc.w, spr.rc.h };
 		} else if (align == SBA_RIGHT) {
-			drc = { clip_rc.x + clip_rc.w - trc.w, clip_rc.y, trc.w, trc.h };
+			drc = { clip_rc.x + clip_rc.w - spr.rc.w, clip_rc.y, spr.rc.w, spr.rc.h };
 		} else {
-			drc = { clip_rc.x + ((clip_rc.w - trc.w) / 2), clip_rc.y, trc.w, trc.h };
-		}
-		drc.y = clip_rc.y + 1 + ((clip_rc.h - trc.h) / 2);
-		SDL_RenderCopy(config.mRenderer, tex, &trc, &drc);
-
-		if (orig_clip.w || orig_clip.h) {
-			SDL_RenderSetClipRect(config.mRenderer, &orig_clip);
-		} else {
-			SDL_RenderSetClipRect(config.mRenderer, NULL);
+			drc = { clip_rc.x + ((clip_rc.w - spr.rc.w) / 2), clip_rc.y, spr.rc.w, spr.rc.h };
 		}
+		drc.y = clip_rc.y + 1 + ((clip_rc.h - spr.rc.h) / 2);
+		// rendered white, see text_job_render()
+		draw_sprite(spr, drc, colors.menu_normal_text, &clip_rc);
 	}
-
 }
 
 int SDL_StatusBar::AddSection(shared_ptr<SDL_StatusBarSection>& sec) {
@@ -142,9 +145,55 @@ bool SDL_StatusBar::SetSectionText(int ind, const string& str) {
 	return false;
 }
 
+class StatusBarNode : public SceneNode {
+public:
+	SDL_StatusBar* bar;
+
+	StatusBarNode(SDL_StatusBar* pbar) : bar(pbar) {}
+
+	bool GetState(string& state) {
+		state += mprintf("%d,%d,%d,%d", bar->rc.x, bar->rc.y, bar->rc.w, bar->rc.h);
+		return true;
+	}
+	SDL_Rect GetBounds() {
+		return bar->rc;
+	}
+	void Draw() {
+		draw_fill(bar->rc, { colors.menu_inactive_bg.r, colors.menu_inactive_bg.g, colors.menu_inactive_bg.b, SDL_ALPHA_OPAQUE });
+	}
+};
+
+// Each section is its own node, so new text only redraws that section
+class StatusBarSectionNode : public SceneNode {
+public:
+	shared_ptr<SDL_StatusBarSection> sec;
+
+	StatusBarSectionNode(shared_ptr<SDL_StatusBarSection>& psec) : sec(psec) {}
+
+	void Prepare() {
+		sec->Update();
+	}
+	bool GetState(string& state) {
+		sec->GetState(state);
+		return true;
+	}
+	SDL_Rect GetBounds() {
+		return sec->rc;
+	}
+	void Draw() {
+		sec->Draw();
+	}
+};
+
+void SDL_StatusBar::AddToScene(Scene& scene) {
+	scene.Add(make_shared<StatusBarNode>(this));
+	for (auto& s : _sections) {
+		scene.Add(make_shared<StatusBarSectionNode>(s));
+	}
+}
+
 void SDL_StatusBar::Draw() {
-	SDL_SetRenderDrawColor(config.mRenderer, colors.menu_inactive_bg.r, colors.menu_inactive_bg.g, colors.menu_inactive_bg.b, SDL_ALPHA_OPAQUE);
-	SDL_RenderFillRect(config.mRenderer, &rc);
+	draw_fill(rc, { colors.menu_inactive_bg.r, colors.menu_inactive_bg.g, colors.menu_inactive_bg.b, SDL_ALPHA_OPAQUE });
 	for (auto& s : _sections) {
 		s->Draw();
 	}
@@ -19,23 +19,21 @@ struct STATUS_BAR_SECTION_SIZE {
 };
 
 class SDL_StatusBar;
+class Scene;
 
 class SDL_StatusBarSection {
 private:
-	SDL_Texture * tex = NULL;
-	SDL_Size tex_size = { 0,0 };
+	SPRITE spr;
+	bool spr_stale = false; // spr still shows the previous text
+	uint32 ticket = 0; // text worker request for the new sprite
 	string _text;
 protected:
 	friend class SDL_StatusBar;
+	friend class StatusBarSectionNode;
 	SDL_Rect rc = { 0 };
 	STATUS_BAR_SECTION_SIZE sizing = { 0 };
 
-	inline void clearCachedTexture() {
-		if (tex != NULL) {
-			SDL_DestroyTexture(tex);
-			tex = NULL;
-		}
-	}
+	void clearCachedSprite();
 public:
 	//const STATUS_BAR_SECTION_SIZE& sizing = _sizing;
 	STATUS_BAR_ALIGN align = SBA_LEFT;
@@ -47,10 +45,12 @@ public:
 	void SetText(const string& str);
 	void SetSizingPercent(double per, int min_pixels_wide = 0);
 	void SetSizingFixed(int width);
+	void Update(); // brings the text sprite up to date, Draw() calls it too
+	void GetState(string& state); // appends everything Draw() output depends on
 	void Draw();
 
 	~SDL_StatusBarSection() {
-		clearCachedTexture();
+		clearCachedSprite();
 	}
 };
 
@@ -71,12 +71,13 @@ public:
 	bool GetStatusText(const SDL_Point& pt, string& str);
 
 	void Draw();
+	void AddToScene(Scene& scene); // adds the bar and a node per section, the sections have to exist already
 	void CalcSections(); // if you modify section sizing, call this or SetRect() to recalculate them
 	void SetRect(const SDL_Rect& rc);
 	void Reset();
 	void ClearCachedTextures() {
 		for (auto& x : _sections) {
-			x->clearCachedTexture();
+			x->clearCachedSprite();
 		}
 	}
 };
@@ -0,0 +1,108 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2026 Drift Solutions
+
+#include "alarmclock.h"
+#include <unordered_map>
+
+// Textures that haven't been drawn in this many rendered frames get dropped
+#define TEXT_CACHE_MAX_UNUSED_FRAMES 300
+
+TEXT_CACHE_KEY::TEXT_CACHE_KEY(TTF_Font* pfont, int pptSize, int pstyle, int pwrap_width, int fit_w, int fit_h, uint8 palign, const string& pstr) {
+	font = pfont;
+	ptSize = pptSize;
+	style = pstyle;
+	wrap_width = pwrap_width;
+	fit = { fit_w, fit_h };
+	align = palign;
+	str = pstr;
+
+	hash = std::hash<string>()(str);
+	auto combine = [this](size_t v) {
+		hash ^= v + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+	};
+	combine(std::hash<void*>()(font));
+	combine((size_t)ptSize);
+	combine((size_t)style);
+	combine((size_t)wrap_width);
+	combine(((size_t)fit.w << 16) ^ (size_t)fit.h);
+	combine((size_t)align);
+}
+
+bool TEXT_CACHE_KEY::operator==(const TEXT_CACHE_KEY& b) const {
+	return hash == b.hash && font == b.font && ptSize == b.ptSize && style == b.style && wrap_width == b.wrap_width && fit.w == b.fit.w && fit.h == b.fit.h && align == b.align && str == b.str;
+}
+
+struct TEXT_CACHE_ENTRY {
+	SPRITE spr;
+	uint32 last_used = 0;
+	bool pinned = false;
+};
+
+static unordered_map<TEXT_CACHE_KEY, TEXT_CACHE_ENTRY, TEXT_CACHE_KEY_HASH> text_cache;
+static uint64 text_cache_hits = 0, text_cache_misses = 0;
+
+const SPRITE* text_cache_find(const TEXT_CACHE_KEY& key) {
+	auto x = text_cache.find(key);
+	if (x == text_cache.end()) {
+		text_cache_misses++;
+		return NULL;
+	}
+
+	text_cache_hits++;
+	x->second.last_used = config.cur_frame;
+	return &x->second.spr;
+}
+
+const SPRITE* text_cache_add(const TEXT_CACHE_KEY& key, SDL_Surface* src, bool pinned) {
+	if (src == NULL) {
+		return NULL;
+	}
+
+	SPRITE spr;
+	if (!sprite_create(src, spr, TO_TEXT)) {
+		return NULL;
+	}
+
+	auto& e = text_cache[key];
+	sprite_free(e.spr);
+	e.spr = spr;
+	e.last_used = config.cur_frame;
+	e.pinned = pinned;
+	if (spr.page < 0) {
+		// big text has a texture of its own, it's dropped from the cache and rendered again if it's needed
+		texture_set_evict(spr.tex, [key]() {
+			auto x = text_cache.find(key);
+			if (x != text_cache.end()) {
+				sprite_free(x->second.spr);
+				text_cache.erase(x);
+			}
+		});
+	}
+	return &e.spr;
+}
+
+void text_cache_end_frame() {
+	if (config.cur_frame % 30 != 0) {
+		return;
+	}
+
+	for (auto x = text_cache.begin(); x != text_cache.end();) {
+		if (!x->second.pinned && config.cur_frame - x->second.last_used > TEXT_CACHE_MAX_UNUSED_FRAMES) {
+			sprite_free(x->second.spr);
+			x = text_cache.erase(x);
+		} else {
+			x++;
+		}
+	}
+}
+
+void text_cache_clear() {
+	for (auto& x : text_cache) {
+		sprite_free(x.second.spr);
+	}
+	text_cache.clear();
+}
+
+string text_cache_stats() {
+	return mprintf("Text cache: %zu sprites, %llu hits, %llu misses", text_cache.size(), (unsigned long long)text_cache_hits, (unsigned long long)text_cache_misses);
+}
@@ -0,0 +1,181 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2026 Drift Solutions
+
+#include "alarmclock.h"
+
+/*
+* Finds the largest point size a string fits in with a binary search over point sizes. Every measurement goes through
+* a per-size metrics cache and the final answer is memoized, so a string that has been fit once never touches
+* SDL_ttf again.
+*/
+
+// Dynamic strings (status bar timestamps, etc.) would otherwise grow these forever
+#define TEXT_FIT_MAX_ENTRIES 4096
+
+TextFitter text_fitter(GetFontSize);
+
+static string metrics_key(int ptSize, int style, const string& str) {
+	return mprintf("%d,%d|", ptSize, style) + str;
+}
+
+SDL_Size TextFitter::measureLine(int ptSize, int style, const string& str) {
+	string key = metrics_key(ptSize, style, str);
+	auto x = text_metrics.find(key);
+	if (x != text_metrics.end()) {
+		metric_hits++;
+		return x->second;
+	}
+	metric_misses++;
+
+	SDL_Size ret = { 0, 0 };
+	auto font = GetFont(ptSize);
+	if (font != NULL) {
+		int old = TTF_GetFontStyle(font);
+		TTF_SetFontStyle(font, style);
+		TTF_SizeUTF8(font, str.c_str(), &ret.w, &ret.h);
+		TTF_SetFontStyle(font, old);
+	}
+
+	if (text_metrics.size() >= TEXT_FIT_MAX_ENTRIES) {
+		text_metrics.clear();
+	}
+	text_metrics[key] = ret;
+	return ret;
+}
+
+const TextFitter::FONT_SIZE_METRICS& TextFitter::getFontMetrics(int ptSize, int style) {
+	auto k = make_pair(ptSize, style);
+	auto x = font_metrics.find(k);
+	if (x != font_metrics.end()) {
+		return x->second;
+	}
+
+	FONT_SIZE_METRICS m;
+	auto font = GetFont(ptSize);
+	if (font != NULL) {
+		m.height = TTF_FontHeight(font);
+		m.line_skip = TTF_FontLineSkip(font);
+		m.space_w = measureLine(ptSize, style, " ").w;
+	}
+	return font_metrics[k] = m;
+}
+
+/*
+* Greedy word wrap like TTF_RenderUTF8_Blended_Wrapped() does. Line widths are summed from cached word widths, so it can be
+* off by a pixel or two of kerning, which only matters for text that barely fits.
+*/
+SDL_Size TextFitter::measureWrapped(int ptSize, int style, const string& str, int wrap_width) {
+	const auto& fm = getFontMetrics(ptSize, style);
+	int lines = 0;
+	int widest = 0;
+
+	size_t start = 0;
+	while (start <= str.length()) {
+		size_t end = str.find('\n', start);
+		if (end == string::npos) {
+			end = str.length();
+		}
+
+		lines++;
+		int cur_w = 0;
+		size_t pos = start;
+		while (pos < end) {
+			size_t word_end = str.find(' ', pos);
+			if (word_end == string::npos || word_end > end) {
+				word_end = end;
+			}
+			if (word_end > pos) {
+				int word_w = measureLine(ptSize, style, str.substr(pos, word_end - pos)).w;
+				if (cur_w > 0 && cur_w + fm.space_w + word_w > wrap_width) {
+					widest = max(widest, cur_w);
+					lines++;
+					cur_w = word_w;
+				} else {
+					cur_w += (cur_w > 0 ? fm.space_w : 0) + word_w;
+				}
+			}
+			pos = word_end + 1;
+		}
+		widest = max(widest, cur_w);
+
+		start = end + 1;
+	}
+
+	return { min(widest, wrap_width), ((lines - 1) * fm.line_skip) + fm.height };
+}
+
+bool TextFitter::fits(int ptSize, const string& str, const SDL_Size& box, int style, uint8 flags) {
+	SDL_Size sz = (flags & TFF_WRAPPED) ? measureWrapped(ptSize, style, str, box.w) : measureLine(ptSize, style, str);
+	if ((flags & TFF_WIDTH) && sz.w > box.w) {
+		return false;
+	}
+	if ((flags & TFF_HEIGHT) && sz.h > box.h) {
+		return false;
+	}
+	return true;
+}
+
+static string fit_key(const string& str, int max_size, const SDL_Size& box, int style, uint8 flags, int min_size) {
+	return mprintf("%d,%d,%d,%d,%d,%u|", max_size, min_size, box.w, box.h, style, flags) + str;
+}
+
+int TextFitter::FitSize(const string& str, int max_size, const SDL_Size& box, int style, uint8 flags, int min_size) {
+	if (max_size <= min_size) {
+		return max_size;
+	}
+
+	string key = fit_key(str, max_size, box, style, flags, min_size);
+	auto x = fit_memo.find(key);
+	if (x != fit_memo.end()) {
+		fit_hits++;
+		return x->second;
+	}
+	fit_misses++;
+
+	int ret = min_size;
+	if (fits(max_size, str, box, style, flags)) {
+		ret = max_size;
+	} else {
+		// largest size in [lo, hi] that fits, lo is the fallback if nothing does
+		int lo = min_size, hi = max_size - 1;
+		while (lo < hi) {
+			int mid = (lo + hi + 1) / 2;
+			if (fits(mid, str, box, style, flags)) {
+				lo = mid;
+			} else {
+				hi = mid - 1;
+			}
+		}
+		ret = lo;
+	}
+
+	if (fit_memo.size() >= TEXT_FIT_MAX_ENTRIES) {
+		fit_memo.clear();
+	}
+	fit_memo[key] = ret;
+	return ret;
+}
+
+void TextFitter::Merge(const TextFitter& other) {
+	if (fit_memo.size() + other.fit_memo.size() >= TEXT_FIT_MAX_ENTRIES) {
+		fit_memo.clear();
+	}
+	// only the answers, the metrics are tied to the other fitter's font faces
+	fit_memo.insert(other.fit_memo.begin(), other.fit_memo.end());
+}
+
+string TextFitter::Stats() const {
+	return mprintf("Text fitting: %llu hits, %llu misses; metrics: %llu hits, %llu misses", (unsigned long long)fit_hits, (unsigned long long)fit_misses, (unsigned long long)metric_hits, (unsigned long long)metric_misses);
+}
+
+int text_fit_size(const string& str, int max_size, const SDL_Size& box, int style, uint8 flags, int min_size) {
+	return text_fitter.FitSize(str, max_size, box, style, flags, min_size);
+}
+
+void text_fit_merge(const TextFitter& other) {
+	text_fitter.Merge(other);
+}
+
+string text_fit_stats() {
+	return text_fitter.Stats();
+}
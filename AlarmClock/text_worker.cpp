@@ -0,0 +1,324 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2026 Drift Solutions
+
+#include "alarmclock.h"
+#include <deque>
+
+/*
+* Async text rasterization. The render thread queues TEXT_JOBs and keeps drawing whatever it had before, a worker thread
+* renders them with its own font faces and the render thread picks the surfaces up and uploads them. Nothing in here
+* touches the renderer except text_async_process(), which runs on the render thread.
+*/
+
+struct TEXT_ASYNC_REQUEST {
+	uint32 ticket = 0;
+	TEXT_JOB job;
+	bool to_cache = false; // upload into the text cache under key instead of waiting for text_async_take()
+	TEXT_CACHE_KEY key;
+	Uint64 queued = 0;
+};
+
+struct TEXT_ASYNC_RESULT {
+	SDL_Surface* src = NULL;
+	bool to_cache = false;
+	TEXT_CACHE_KEY key;
+};
+
+static DSL_Mutex asyncMutex;
+static SDL_sem* async_sem = NULL;
+static deque<TEXT_ASYNC_REQUEST> queue;
+static map<uint32, TEXT_ASYNC_RESULT> results;
+static unordered_map<TEXT_CACHE_KEY, uint32, TEXT_CACHE_KEY_HASH> pending_keys; // to_cache requests that are queued or done
+static uint32 next_ticket = 1;
+static uint32 in_progress = 0; // ticket the worker is rendering right now
+static bool in_progress_cancelled = false;
+static bool worker_running = false;
+static bool async_paused = false; // -benchmark=text turns it off for the synchronous pass
+static uint64 async_requests = 0, async_completed = 0, async_latency_us = 0, async_max_latency_us = 0;
+static uint64 pending_draws = 0;
+
+DSL_DEFINE_THREAD(TextWorkerThread) {
+	DSL_THREAD_START
+
+	auto faces = make_shared<map<int, TTF_Font*>>();
+	TextFitter fitter([faces](int ptSize) -> TTF_Font* {
+		auto x = faces->find(ptSize);
+		if (x != faces->end()) {
+			return x->second;
+		}
+		auto font = OpenPrivateFontSize(ptSize);
+		if (font != NULL) {
+			(*faces)[ptSize] = font;
+		}
+		return font;
+	});
+
+	while (!config.shutdown_now) {
+		// timeout so we notice shutdown_now
+		if (SDL_SemWaitTimeout(async_sem, 500) != 0) {
+			// idle, a good time to write out new raster cache entries (at most once a minute)
+			raster_cache_save();
+			continue;
+		}
+
+		TEXT_ASYNC_REQUEST req;
+		{
+			AutoMutex(asyncMutex);
+			if (queue.empty()) {
+				// cancelled after it was posted
+				continue;
+			}
+			req = queue.front();
+			queue.pop_front();
+			in_progress = req.ticket;
+			in_progress_cancelled = false;
+		}
+
+		TEXT_ASYNC_RESULT res;
+		res.src = text_job_render(req.job, fitter);
+		res.to_cache = req.to_cache;
+		res.key = req.key;
+
+		{
+			AutoMutex(asyncMutex);
+			in_progress = 0;
+			if (in_progress_cancelled) {
+				if (res.src != NULL) {
+					SDL_FreeSurface(res.src);
+				}
+				continue;
+			}
+			results[req.ticket] = res;
+			uint64 us = (SDL_GetTicks64() - req.queued) * 1000;
+			async_completed++;
+			async_latency_us += us;
+			async_max_latency_us = max(async_max_latency_us, us);
+		}
+		request_redraw();
+	}
+
+	for (auto& x : *faces) {
+		ClosePrivateFont(x.second);
+	}
+	faces->clear();
+
+	DSL_THREAD_END
+}
+
+void start_text_worker() {
+	if (worker_running) {
+		return;
+	}
+	async_sem = SDL_CreateSemaphore(0);
+	if (async_sem == NULL) {
+		printf("Error creating text worker semaphore, rendering text synchronously: %s\n", SDL_GetError());
+		return;
+	}
+	worker_running = true;
+	DSL_StartThread(TextWorkerThread, NULL, "Text Rasterizer");
+}
+
+bool text_async_enabled() {
+	return worker_running && !async_paused;
+}
+
+static uint32 queue_request(TEXT_ASYNC_REQUEST& req) {
+	req.ticket = next_ticket++;
+	if (next_ticket == 0) {
+		next_ticket = 1;
+	}
+	req.queued = SDL_GetTicks64();
+	queue.push_back(req);
+	async_requests++;
+	SDL_SemPost(async_sem);
+	return req.ticket;
+}
+
+uint32 text_async_request(const TEXT_JOB& job) {
+	AutoMutex(asyncMutex);
+	TEXT_ASYNC_REQUEST req;
+	req.job = job;
+	return queue_request(req);
+}
+
+void text_async_request_cached(const TEXT_CACHE_KEY& key, const TEXT_JOB& job) {
+	AutoMutex(asyncMutex);
+	if (pending_keys.count(key)) {
+		return;
+	}
+	TEXT_ASYNC_REQUEST req;
+	req.job = job;
+	req.to_cache = true;
+	req.key = key;
+	pending_keys[key] = queue_request(req);
+}
+
+bool text_async_take(uint32 ticket, SDL_Surface*& src) {
+	AutoMutex(asyncMutex);
+	auto x = results.find(ticket);
+	if (x == results.end()) {
+		return false;
+	}
+	src = x->second.src;
+	results.erase(x);
+	return true;
+}
+
+void text_async_cancel(uint32 ticket) {
+	if (ticket == 0) {
+		return;
+	}
+	AutoMutex(asyncMutex);
+	for (auto x = queue.begin(); x != queue.end(); x++) {
+		if (x->ticket == ticket) {
+			queue.erase(x);
+			return;
+		}
+	}
+	auto x = results.find(ticket);
+	if (x != results.end()) {
+		if (x->second.src != NULL) {
+			SDL_FreeSurface(x->second.src);
+		}
+		results.erase(x);
+	} else if (ticket == in_progress) {
+		in_progress_cancelled = true;
+	}
+}
+
+void text_async_note_pending() {
+	pending_draws++;
+}
+
+uint64 text_async_pending_draws() {
+	return pending_draws;
+}
+
+bool text_sprite_update(uint32& ticket, const TEXT_JOB& job, SPRITE& spr) {
+	SDL_Surface* src = NULL;
+	if (text_async_enabled()) {
+		if (ticket == 0) {
+			ticket = text_async_request(job);
+		}
+		if (!text_async_take(ticket, src)) {
+			pending_draws++;
+			return false;
+		}
+		ticket = 0;
+	} else {
+		text_async_cancel(ticket);
+		ticket = 0;
+		src = text_job_render(job, text_fitter);
+	}
+
+	sprite_free(spr);
+	if (src != NULL) {
+		sprite_create(src, spr, TO_TEXT);
+		SDL_FreeSurface(src);
+	}
+	return true;
+}
+
+void text_async_process() {
+	if (!worker_running) {
+		return;
+	}
+
+	vector<TEXT_ASYNC_RESULT> done;
+	{
+		AutoMutex(asyncMutex);
+		for (auto x = results.begin(); x != results.end();) {
+			if (x->second.to_cache) {
+				pending_keys.erase(x->second.key);
+				done.push_back(x->second);
+				x = results.erase(x);
+			} else {
+				x++;
+			}
+		}
+	}
+
+	for (auto& r : done) {
+		if (r.src != NULL) {
+			text_cache_add(r.key, r.src);
+			SDL_FreeSurface(r.src);
+		}
+	}
+}
+
+// Call after the worker has exited
+void text_async_clear() {
+	AutoMutex(asyncMutex);
+	queue.clear();
+	for (auto& x : results) {
+		if (x.second.src != NULL) {
+			SDL_FreeSurface(x.second.src);
+		}
+	}
+	results.clear();
+	pending_keys.clear();
+	in_progress = 0;
+	if (async_sem != NULL) {
+		SDL_DestroySemaphore(async_sem);
+		async_sem = NULL;
+	}
+	worker_running = false;
+}
+
+string text_async_stats() {
+	AutoMutex(asyncMutex);
+	if (!worker_running) {
+		return "Async text: off";
+	}
+	return mprintf("Async text: %llu requests, %llu done, %.1f ms mean latency, %.1f ms max, %zu queued, %llu draws showed old text", (unsigned long long)async_requests, (unsigned long long)async_completed, async_completed ? double(async_latency_us) / double(async_completed) / 1000.0 : 0.0, double(async_max_latency_us) / 1000.0, queue.size(), (unsigned long long)pending_draws);
+}
+
+/*
+* -benchmark=text: draws a frame with a new clock-sized time string and a wrapped banner every frame, first rendering
+* the text on the render thread and then through the worker, and prints the frame time percentiles for each. Every
+* string is new, so this is the worst case for the render thread; the async pass shows the old text instead of waiting.
+*/
+void text_benchmark(int frames) {
+	start_text_worker();
+	if (!worker_running) {
+		return;
+	}
+
+	const uint64 freq = SDL_GetPerformanceFrequency();
+	for (int pass = 0; pass < 2; pass++) {
+		async_paused = (pass == 0);
+		text_cache_clear();
+		FrameHistogram h;
+		for (int i = 0; i < frames; i++) {
+			Uint64 start = SDL_GetPerformanceCounter();
+			text_async_process();
+			SDL_SetRenderDrawColor(config.mRenderer, colors.clock_bg);
+			SDL_RenderClear(config.mRenderer);
+			batch_begin();
+
+			TEXT_JOB job;
+			job.type = TJ_FIT;
+			job.ptSize = TIME_FONT_SIZE;
+			job.rc = config.main_area;
+			job.align = DTA_CENTER | DTA_MIDDLE;
+			job.col = colors.clock_text;
+			job.str = mprintf("%d:%02d", 1 + ((pass * frames + i) / 60) % 12, (pass * frames + i) % 60);
+			draw_text(job);
+
+			job.type = TJ_FIXED_WRAPPED;
+			job.ptSize = ALARM_FONT_SIZE;
+			job.rc = config.title_area;
+			job.str = mprintf("Time to Wake Up! (%d)", i);
+			draw_text(job);
+			batch_end();
+
+			SDL_RenderPresent(config.mRenderer);
+			h.Add((SDL_GetPerformanceCounter() - start) * 1000000 / freq);
+			text_cache_end_frame();
+			config.cur_frame++;
+		}
+		printf("Text (%s): p50 %.1f ms, p95 %.1f ms, p99 %.1f ms, max %.1f ms over %d frames\n", async_paused ? "sync" : "async", double(h.Percentile(50)) / 1000.0, double(h.Percentile(95)) / 1000.0, double(h.Percentile(99)) / 1000.0, double(h.max_us) / 1000.0, frames);
+	}
+	async_paused = false;
+	printf("%s\n", text_async_stats().c_str());
+}
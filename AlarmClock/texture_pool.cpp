@@ -0,0 +1,154 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2026 Drift Solutions
+
+#include "alarmclock.h"
+
+/*
+* Streaming textures for sprites too big for the atlas (the big clock, the alarm banner). Sizes are rounded up to a
+* bucket so a new time or message almost always fits a texture that was just given back, and the pixels are copied in
+* with SDL_LockTexture() instead of the driver allocating and converting a new texture for every text change. Sprites
+* only use the top left w x h of a pooled texture.
+*/
+
+#define POOL_BUCKET_STEP 64 // sizes are rounded up to this
+#define POOL_MAX_IDLE_PER_BUCKET 2
+#define POOL_MAX_IDLE 16
+
+struct POOL_TEXTURE {
+	SDL_Size size;
+	bool idle = false;
+	uint32 idle_since = 0;
+};
+
+static unordered_map<SDL_Texture*, POOL_TEXTURE> pool; // every texture the pool made, idle or handed out
+static bool pool_failed = false;
+static uint64 pool_hits = 0, pool_misses = 0, pool_destroyed = 0;
+
+static int bucket(int x) {
+	return ((x + POOL_BUCKET_STEP - 1) / POOL_BUCKET_STEP) * POOL_BUCKET_STEP;
+}
+
+static size_t idle_count(const SDL_Size* size) {
+	size_t ret = 0;
+	for (auto& x : pool) {
+		if (x.second.idle && (size == NULL || (x.second.size.w == size->w && x.second.size.h == size->h))) {
+			ret++;
+		}
+	}
+	return ret;
+}
+
+static void destroy_pooled(SDL_Texture* tex) {
+	pool.erase(tex);
+	texture_destroy(tex);
+	pool_destroyed++;
+}
+
+SDL_Texture* texture_pool_acquire(TEXTURE_OWNER owner, int w, int h, SDL_Size& tex_size) {
+	if (pool_failed) {
+		return NULL;
+	}
+
+	const SDL_Size size = { bucket(w), bucket(h) };
+	for (auto& x : pool) {
+		if (x.second.idle && x.second.size.w == size.w && x.second.size.h == size.h) {
+			x.second.idle = false;
+			texture_set_owner(x.first, owner);
+			texture_set_evict(x.first, nullptr);
+			tex_size = size;
+			pool_hits++;
+			return x.first;
+		}
+	}
+
+	pool_misses++;
+	SDL_Texture* tex = texture_create(owner, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, size.w, size.h);
+	if (tex == NULL) {
+		printf("Error creating streaming texture, big sprites will get static textures: %s\n", SDL_GetError());
+		pool_failed = true;
+		return NULL;
+	}
+	SDL_SetTextureBlendMode(tex, SDL_BLENDMODE_BLEND);
+	// only the top left of it is drawn from, filtering could pull in whatever is past that
+	SDL_SetTextureScaleMode(tex, SDL_ScaleModeNearest);
+	POOL_TEXTURE p;
+	p.size = size;
+	pool[tex] = p;
+	tex_size = size;
+	return tex;
+}
+
+bool texture_pool_upload(SDL_Texture* tex, SDL_Surface* src) {
+	SDL_Surface* conv = src;
+	if (src->format->format != SDL_PIXELFORMAT_ARGB8888) {
+		conv = SDL_ConvertSurfaceFormat(src, SDL_PIXELFORMAT_ARGB8888, 0);
+		if (conv == NULL) {
+			return false;
+		}
+	}
+
+	// the batch might still have quads from what was in it before
+	batch_flush_texture(tex);
+	bool ret = false;
+	SDL_Rect rc = { 0, 0, conv->w, conv->h };
+	void* pixels = NULL;
+	int pitch = 0;
+	if (SDL_LockTexture(tex, &rc, &pixels, &pitch) == 0) {
+		const size_t row = size_t(conv->w) * 4;
+		for (int y = 0; y < conv->h; y++) {
+			memcpy((uint8*)pixels + (size_t(y) * pitch), (const uint8*)conv->pixels + (size_t(y) * conv->pitch), row);
+		}
+		SDL_UnlockTexture(tex);
+		ret = true;
+	}
+
+	if (conv != src) {
+		SDL_FreeSurface(conv);
+	}
+	return ret;
+}
+
+bool texture_pool_release(SDL_Texture* tex) {
+	auto x = pool.find(tex);
+	if (x == pool.end()) {
+		return false;
+	}
+
+	if (idle_count(&x->second.size) >= POOL_MAX_IDLE_PER_BUCKET) {
+		destroy_pooled(tex);
+		return true;
+	}
+	if (idle_count(NULL) >= POOL_MAX_IDLE) {
+		// make room by dropping the one that's been idle longest
+		SDL_Texture* oldest = NULL;
+		uint32 oldest_since = 0;
+		for (auto& p : pool) {
+			if (p.second.idle && (oldest == NULL || p.second.idle_since < oldest_since)) {
+				oldest = p.first;
+				oldest_since = p.second.idle_since;
+			}
+		}
+		if (oldest != NULL) {
+			destroy_pooled(oldest);
+		}
+		x = pool.find(tex);
+	}
+
+	x->second.idle = true;
+	x->second.idle_since = config.cur_frame;
+	texture_set_owner(tex, TO_POOL);
+	// idle textures are the first thing to go when the texture budget is tight
+	texture_set_evict(tex, [tex]() { destroy_pooled(tex); });
+	return true;
+}
+
+// Every pooled sprite has to be freed before this
+void texture_pool_clear() {
+	while (pool.size()) {
+		destroy_pooled(pool.begin()->first);
+	}
+}
+
+string texture_pool_stats() {
+	return mprintf("Texture pool: %zu textures (%zu idle), %llu reused, %llu created, %llu destroyed", pool.size(), idle_count(NULL), (unsigned long long)pool_hits, (unsigned long long)pool_misses, (unsigned long long)pool_destroyed);
+}
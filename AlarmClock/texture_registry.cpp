@@ -0,0 +1,186 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2026 Drift Solutions
+
+#include "alarmclock.h"
+
+/*
+* Every texture the UI creates goes through here, so there's one place that knows how much GPU memory is in use and by
+* what. Owners that can rebuild a texture register an evict callback; when the total goes over config.texture_budget
+* the least recently used of those get evicted at the end of the frame and their owners make them again the next time
+* they're needed. Textures touched this frame are never evicted, so what's on screen can't thrash.
+*/
+
+struct TEXTURE_ENTRY {
+	TEXTURE_OWNER owner = TO_OTHER;
+	uint64 bytes = 0;
+	uint32 last_used = 0;
+	function<void()> evict;
+};
+
+static const char* owner_names[TO_COUNT] = { "atlas", "text", "glyphs", "shapes", "images", "flip face", "backbuffer", "pool", "other" };
+
+static unordered_map<SDL_Texture*, TEXTURE_ENTRY> textures;
+static uint64 owner_bytes[TO_COUNT] = { 0 };
+static uint64 owner_count[TO_COUNT] = { 0 };
+static uint64 total_bytes = 0, peak_bytes = 0;
+static uint64 evictions = 0, evicted_bytes = 0;
+static Uint64 last_over_warning = 0;
+
+static uint64 texture_bytes(SDL_Texture* tex) {
+	Uint32 format = 0;
+	int w = 0, h = 0;
+	if (SDL_QueryTexture(tex, &format, NULL, &w, &h) != 0) {
+		return 0;
+	}
+	int bpp = SDL_BYTESPERPIXEL(format);
+	if (bpp == 0) {
+		// YUV and friends, close enough
+		bpp = 4;
+	}
+	return uint64(w) * uint64(h) * uint64(bpp);
+}
+
+static SDL_Texture* add_texture(TEXTURE_OWNER owner, SDL_Texture* tex) {
+	if (tex == NULL) {
+		return NULL;
+	}
+
+	TEXTURE_ENTRY e;
+	e.owner = owner;
+	e.bytes = texture_bytes(tex);
+	e.last_used = config.cur_frame;
+	textures[tex] = e;
+
+	owner_bytes[owner] += e.bytes;
+	owner_count[owner]++;
+	total_bytes += e.bytes;
+	peak_bytes = max(peak_bytes, total_bytes);
+	return tex;
+}
+
+static void remove_texture(unordered_map<SDL_Texture*, TEXTURE_ENTRY>::iterator x) {
+	owner_bytes[x->second.owner] -= x->second.bytes;
+	owner_count[x->second.owner]--;
+	total_bytes -= x->second.bytes;
+	textures.erase(x);
+}
+
+SDL_Texture* texture_create(TEXTURE_OWNER owner, Uint32 format, int access, int w, int h) {
+	return add_texture(owner, SDL_CreateTexture(config.mRenderer, format, access, w, h));
+}
+
+SDL_Texture* texture_create_from_surface(TEXTURE_OWNER owner, SDL_Surface* src) {
+	return add_texture(owner, SDL_CreateTextureFromSurface(config.mRenderer, src));
+}
+
+void texture_destroy(SDL_Texture* tex) {
+	if (tex == NULL) {
+		return;
+	}
+	auto x = textures.find(tex);
+	if (x != textures.end()) {
+		remove_texture(x);
+	}
+	SDL_DestroyTexture(tex);
+}
+
+void texture_set_owner(SDL_Texture* tex, TEXTURE_OWNER owner) {
+	auto x = textures.find(tex);
+	if (x != textures.end() && x->second.owner != owner) {
+		owner_bytes[x->second.owner] -= x->second.bytes;
+		owner_count[x->second.owner]--;
+		x->second.owner = owner;
+		owner_bytes[owner] += x->second.bytes;
+		owner_count[owner]++;
+	}
+}
+
+void texture_touch(SDL_Texture* tex) {
+	auto x = textures.find(tex);
+	if (x != textures.end()) {
+		x->second.last_used = config.cur_frame;
+	}
+}
+
+void texture_set_evict(SDL_Texture* tex, function<void()> evict) {
+	auto x = textures.find(tex);
+	if (x != textures.end()) {
+		x->second.evict = evict;
+	}
+}
+
+static string format_bytes(uint64 bytes) {
+	return mprintf("%.1f MB", double(bytes) / 1048576.0);
+}
+
+void texture_budget_end_frame() {
+	const uint64 budget = uint64(config.texture_budget) * 1048576;
+	if (budget == 0 || total_bytes <= budget) {
+		return;
+	}
+
+	vector<pair<uint32, SDL_Texture*>> candidates;
+	for (auto& x : textures) {
+		if (x.second.evict && x.second.last_used != config.cur_frame) {
+			candidates.push_back({ x.second.last_used, x.first });
+		}
+	}
+	sort(candidates.begin(), candidates.end());
+
+	uint64 before = total_bytes;
+	size_t num = 0;
+	for (auto& c : candidates) {
+		if (total_bytes <= budget) {
+			break;
+		}
+		auto x = textures.find(c.second);
+		if (x == textures.end()) {
+			// freed by an earlier callback
+			continue;
+		}
+		// the callback frees the texture through texture_destroy()/sprite_free(), which drops the entry
+		auto evict = x->second.evict;
+		evict();
+		x = textures.find(c.second);
+		if (x != textures.end() && x->second.owner == TO_POOL && x->second.evict) {
+			// the owner gave it back to the texture pool, which has its own callback to free it
+			evict = x->second.evict;
+			evict();
+			x = textures.find(c.second);
+		}
+		if (x != textures.end()) {
+			printf("Texture budget: evict callback for a %s texture didn't free it, it won't be evicted again\n", owner_names[x->second.owner]);
+			x->second.evict = nullptr;
+			continue;
+		}
+		num++;
+	}
+
+	if (num) {
+		evictions += num;
+		evicted_bytes += before - total_bytes;
+		printf("Texture budget: evicted %zu textures (%s), %s of %s in use\n", num, format_bytes(before - total_bytes).c_str(), format_bytes(total_bytes).c_str(), format_bytes(budget).c_str());
+	}
+	if (total_bytes > budget && SDL_GetTicks64() - last_over_warning >= 60000) {
+		// everything left is in use or can't be rebuilt
+		last_over_warning = SDL_GetTicks64();
+		printf("Texture budget: still over budget after evicting, %s of %s in use. %s\n", format_bytes(total_bytes).c_str(), format_bytes(budget).c_str(), texture_stats().c_str());
+	}
+}
+
+// Anything still registered at shutdown was leaked by its owner
+void texture_report_leaks() {
+	for (auto& x : textures) {
+		printf("Texture leak: %s texture, %s\n", owner_names[x.second.owner], format_bytes(x.second.bytes).c_str());
+	}
+}
+
+string texture_stats() {
+	string ret = mprintf("Textures: %zu using %s (peak %s, budget %d MB), %llu evicted (%s)", textures.size(), format_bytes(total_bytes).c_str(), format_bytes(peak_bytes).c_str(), config.texture_budget, (unsigned long long)evictions, format_bytes(evicted_bytes).c_str());
+	for (int i = 0; i < TO_COUNT; i++) {
+		if (owner_count[i]) {
+			ret += mprintf("; %s: %llu, %s", owner_names[i], (unsigned long long)owner_count[i], format_bytes(owner_bytes[i]).c_str());
+		}
+	}
+	return ret;
+}
@@ -0,0 +1,365 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2026 Drift Solutions
+
+#include "alarmclock.h"
+
+/*
+* Everything periodic or with a deadline on a thread goes through that thread's TimerWheel: the clock face's minute,
+* the menu's next alarm line and timeout, the light/dark check, Home Assistant's fetch and resend. The wheel is also
+* the one place that knows when the thread next has to wake up, so its loop just sleeps until NextDeadline().
+*
+* A hierarchical timer wheel (like the kernel's): TIMER_LEVELS levels of TIMER_SLOTS slots, each level's slots
+* TIMER_SLOTS times wider than the one below. Adding or cancelling a timer is O(1), and a timer moves down a level
+* each time the level below wraps around until it lands in a TIMER_TICK_MS slot and runs. Callbacks run on the thread
+* that calls Run() and can add or cancel timers, their own included.
+*/
+
+#define TIMER_TICK_MS 10
+#define TIMER_SLOT_BITS 6
+
+static inline Uint64 tick_of(Uint64 ms) {
+	return ms / TIMER_TICK_MS;
+}
+
+static inline Uint64 tick_at_or_after(Uint64 ms) {
+	// never early, up to a tick late
+	return (ms + TIMER_TICK_MS - 1) / TIMER_TICK_MS;
+}
+
+static inline Uint64 level_span(int level) {
+	// ticks covered by one slot at level
+	return Uint64(1) << (TIMER_SLOT_BITS * level);
+}
+
+void TimerWheel::Start() {
+	// not in the constructor, config's wheel is made before SDL is up
+	if (cur_tick == 0) {
+		cur_tick = tick_of(ticks());
+	}
+}
+
+void TimerWheel::Insert(ID id, Uint64 due, bool cascading) {
+	Start();
+	// a new timer can't go in the tick Run() already got to, but one coming down from a higher level can, Run() takes
+	// that slot right after cascading
+	Uint64 due_tick = max(tick_at_or_after(due), cur_tick + (cascading ? 0 : 1));
+	Uint64 delta = due_tick - cur_tick;
+	int level = 0;
+	while (level < TIMER_LEVELS - 1 && delta >= level_span(level + 1)) {
+		level++;
+	}
+	if (level == TIMER_LEVELS - 1 && delta >= level_span(TIMER_LEVELS)) {
+		// further out than the wheel goes, parked in the last slot and put back in when it comes around
+		due_tick = cur_tick + level_span(TIMER_LEVELS) - 1;
+	}
+	slots[level][(due_tick >> (TIMER_SLOT_BITS * level)) & (TIMER_SLOTS - 1)].push_back(id);
+}
+
+TimerWheel::ID TimerWheel::AddAt(Uint64 when, function<void()> fn, Uint64 repeat) {
+	ID id = ++last_id;
+	timers[id] = { when, repeat, 0, fn };
+	Insert(id, when);
+	return id;
+}
+
+TimerWheel::ID TimerWheel::Add(Uint64 ms, function<void()> fn, Uint64 repeat) {
+	return AddAt(ticks() + ms, fn, repeat);
+}
+
+TimerWheel::ID TimerWheel::AddWallClock(int secs, function<void()> fn) {
+	ID id = Add(ms_until_next_interval(secs), fn);
+	timers[id].wall_secs = secs;
+	return id;
+}
+
+void TimerWheel::Set(ID& id, Uint64 ms, function<void()> fn) {
+	Cancel(id);
+	id = Add(ms, fn);
+}
+
+void TimerWheel::Cancel(ID& id) {
+	// the slot keeps the id until it comes around, it's skipped then
+	timers.erase(id);
+	id = 0;
+}
+
+bool TimerWheel::IsSet(ID id) const {
+	return id != 0 && timers.count(id) != 0;
+}
+
+void TimerWheel::Cascade(int level) {
+	auto& slot = slots[level][(cur_tick >> (TIMER_SLOT_BITS * level)) & (TIMER_SLOTS - 1)];
+	vector<ID> ids;
+	ids.swap(slot);
+	for (ID id : ids) {
+		auto x = timers.find(id);
+		if (x != timers.end()) {
+			Insert(id, x->second.due, true);
+		}
+	}
+}
+
+void TimerWheel::Run() {
+	Start();
+	const Uint64 now = ticks();
+	const Uint64 target = tick_of(now);
+	vector<ID> due;
+	while (cur_tick < target) {
+		cur_tick++;
+		// bring the next stretch of each level down once the one below has wrapped around
+		for (int level = 1; level < TIMER_LEVELS && (cur_tick & (level_span(level) - 1)) == 0; level++) {
+			Cascade(level);
+		}
+		auto& slot = slots[0][cur_tick & (TIMER_SLOTS - 1)];
+		due.insert(due.end(), slot.begin(), slot.end());
+		slot.clear();
+	}
+
+	for (ID id : due) {
+		auto x = timers.find(id);
+		if (x == timers.end()) {
+			continue;
+		}
+		// a copy, the callback can cancel its own timer
+		auto fn = x->second.fn;
+		if (x->second.wall_secs) {
+			x->second.due = now + ms_until_next_interval(x->second.wall_secs);
+			Insert(id, x->second.due);
+		} else if (x->second.repeat) {
+			// keeps to its schedule, runs once for however many it missed
+			do {
+				x->second.due += x->second.repeat;
+			} while (x->second.due <= now);
+			Insert(id, x->second.due);
+		} else {
+			timers.erase(x);
+		}
+		runs++;
+		if (fn) {
+			fn();
+		}
+	}
+}
+
+Uint64 TimerWheel::NextDeadline() const {
+	// the first slot with a live timer on each level holds that level's earliest. The current slot has already been
+	// run or moved down, anything in it now is a whole turn of the wheel away, so it's checked last
+	Uint64 ret = 0;
+	for (int level = 0; level < TIMER_LEVELS; level++) {
+		const Uint64 pos = cur_tick >> (TIMER_SLOT_BITS * level);
+		for (int i = 1; i <= TIMER_SLOTS; i++) {
+			bool found = false;
+			for (ID id : slots[level][(pos + i) & (TIMER_SLOTS - 1)]) {
+				auto x = timers.find(id);
+				if (x != timers.end()) {
+					found = true;
+					if (ret == 0 || x->second.due < ret) {
+						ret = x->second.due;
+					}
+				}
+			}
+			if (found) {
+				break;
+			}
+		}
+	}
+	if (ret == 0) {
+		return 0;
+	}
+	// when its slot comes up. One due in a tick Run() already got to went in the next one, see Insert()
+	return max(tick_at_or_after(ret), cur_tick + 1) * TIMER_TICK_MS;
+}
+
+Uint32 TimerWheel::TimeoutMs(Uint32 max_ms) const {
+	Uint64 next = NextDeadline();
+	if (next == 0) {
+		return max_ms;
+	}
+	Uint64 now = ticks();
+	return (next > now) ? (Uint32)min<Uint64>(next - now, max_ms) : 0;
+}
+
+void TimerWheel::WakeWithin(Uint64 ms) {
+	Uint64 when = ticks() + ms;
+	if (!IsSet(wake_id) || when < timers[wake_id].due) {
+		Cancel(wake_id);
+		// nothing to run, Run() being called is the point
+		wake_id = AddAt(when, nullptr);
+	}
+}
+
+string TimerWheel::Stats() const {
+	return mprintf("%zu timers, %llu run", timers.size(), (unsigned long long)runs);
+}
+
+/*
+* -test=timers: runs wheels on a made up clock and checks timers go off when they should: across every level, past
+* the end of the wheel, cancelling and re-arming from their own callbacks, a repeat after a long stall and a timer added
+* for a tick Run() already got to. Sleeping until NextDeadline() like a thread would, nothing may run before it and
+* something has to run at it. Returns false if any fail.
+*/
+static Uint64 test_now = 0;
+static uint64 test_fired = 0;
+
+static Uint64 test_ticks() {
+	return test_now;
+}
+
+static Uint64 test_expected(Uint64 due) {
+	return tick_at_or_after(due) * TIMER_TICK_MS;
+}
+
+static bool test_run_until(TimerWheel& w, Uint64 until) {
+	bool ok = true;
+	for (int i = 0; i < 100000; i++) {
+		const Uint64 next = w.NextDeadline();
+		if (next == 0 || next > until) {
+			return ok;
+		}
+		const uint64 fired = test_fired;
+		if (next <= test_now) {
+			return false;
+		}
+		if (next - 1 > test_now) {
+			test_now = next - 1;
+			w.Run();
+			ok = ok && (test_fired == fired);
+		}
+		test_now = next;
+		w.Run();
+		ok = ok && (test_fired > fired);
+	}
+	return false;
+}
+
+bool timer_wheel_test() {
+	int failed = 0;
+	auto check = [&failed](const char* name, bool ok) {
+		printf("%s: %s\n", ok ? "PASS" : "FAIL", name);
+		if (!ok) {
+			failed++;
+		}
+	};
+
+	{
+		// level 0 to 3, the odd ones land between ticks
+		test_now = 1000000;
+		TimerWheel w(test_ticks);
+		const Uint64 delays[] = { 5, 500, 30007, 1800000, 40ULL * 3600000 };
+		vector<Uint64> due, fired;
+		for (Uint64 d : delays) {
+			due.push_back(test_now + d);
+			w.Add(d, [&fired]() {
+				test_fired++;
+				fired.push_back(test_now);
+			});
+		}
+		bool ok = test_run_until(w, UINT64_MAX) && fired.size() == due.size();
+		for (size_t i = 0; ok && i < due.size(); i++) {
+			ok = (fired[i] == test_expected(due[i]));
+		}
+		check("cascade across levels", ok);
+	}
+
+	{
+		// further out than 2^24 ticks, it's parked and put back in on the way
+		test_now = 1234560;
+		TimerWheel w(test_ticks);
+		const Uint64 due = test_now + (50ULL * 3600000) + 3;
+		Uint64 fired = 0;
+		w.AddAt(due, [&fired]() {
+			test_fired++;
+			fired = test_now;
+		});
+		bool ok = (w.NextDeadline() == test_expected(due));
+		while (ok && test_now + 3600000 < due) {
+			test_now += 3600000;
+			w.Run();
+			ok = (fired == 0 && w.NextDeadline() == test_expected(due));
+		}
+		ok = ok && test_run_until(w, UINT64_MAX) && fired == test_expected(due);
+		check("parked past the end of the wheel", ok);
+	}
+
+	{
+		test_now = 2000000;
+		TimerWheel w(test_ticks);
+		int n = 0;
+		TimerWheel::ID id = 0;
+		id = w.Add(100, [&]() {
+			test_fired++;
+			if (++n == 3) {
+				w.Cancel(id);
+			}
+		}, 100);
+		bool ok = test_run_until(w, test_now + 1000) && n == 3 && !w.IsSet(id);
+		check("repeat cancelling itself", ok);
+
+		int m = 0;
+		vector<Uint64> times;
+		TimerWheel::ID id2 = 0;
+		function<void()> fn;
+		fn = [&]() {
+			test_fired++;
+			times.push_back(test_now);
+			if (++m < 5) {
+				w.Set(id2, 100, fn);
+			}
+		};
+		w.Set(id2, 100, fn);
+		ok = test_run_until(w, test_now + 1000) && m == 5;
+		for (size_t i = 1; ok && i < times.size(); i++) {
+			ok = (times[i] - times[i - 1] == 100);
+		}
+		check("one-shot re-arming itself", ok);
+
+		// the second one is still in the slot being run when the first cancels it
+		int ran = 0;
+		TimerWheel::ID a = 0, b = 0;
+		a = w.Add(200, [&]() {
+			test_fired++;
+			ran++;
+			w.Cancel(b);
+		});
+		b = w.Add(200, [&]() {
+			test_fired++;
+			ran++;
+			w.Cancel(a);
+		});
+		check("cancelled by another in the same tick", test_run_until(w, test_now + 1000) && ran == 1);
+	}
+
+	{
+		test_now = 3000000;
+		TimerWheel w(test_ticks);
+		const Uint64 start = test_now;
+		int n = 0;
+		w.Add(1000, [&n]() {
+			test_fired++;
+			n++;
+		}, 1000);
+		test_now += 10500;
+		w.Run();
+		bool ok = (n == 1 && w.NextDeadline() == start + 11000);
+		ok = ok && test_run_until(w, start + 11000) && n == 2;
+		check("repeat after a stall", ok);
+	}
+
+	{
+		// Run() has done this tick already, so the timer is in the next one and that's what NextDeadline() says
+		test_now = 4000000;
+		TimerWheel w(test_ticks);
+		w.Run();
+		int n = 0;
+		w.AddAt(test_now, [&n]() {
+			test_fired++;
+			n++;
+		});
+		bool ok = (w.NextDeadline() == test_now + TIMER_TICK_MS && w.TimeoutMs(1000) == TIMER_TICK_MS);
+		ok = ok && test_run_until(w, UINT64_MAX) && n == 1;
+		check("due in a tick that's already run", ok);
+	}
+
+	printf("Timer wheel tests: %d failed\n", failed);
+	return (failed == 0);
+}
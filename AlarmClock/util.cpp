@@ -2,273 +2,310 @@
 // Copyright (c) 2026 Drift Solutions
 
 #include "alarmclock.h"
+#include <chrono>
 
 void SDL_SetRenderDrawColor(SDL_Renderer* r, const SDL_Color& col) {
 	SDL_SetRenderDrawColor(r, col.r, col.g, col.b, col.a);
 }
 
-void draw_text(TTF_Font* font, int x, int y, const SDL_Color& col, const char* str, int style) {
-	if (font == NULL) {
-		font = config.backup_font;
+ClipScope::ClipScope(const SDL_Rect& rc) {
+	// queued sprites were meant for the old clip
+	batch_flush();
+	SDL_RenderGetClipRect(config.mRenderer, &old);
+	had_clip = (old.w || old.h);
+	SDL_Rect clip = rc;
+	if (had_clip && !SDL_IntersectRect(&old, &rc, &clip)) {
+		visible = false;
+		return;
 	}
+	SDL_RenderSetClipRect(config.mRenderer, &clip);
+}
 
+ClipScope::~ClipScope() {
+	batch_flush();
+	SDL_RenderSetClipRect(config.mRenderer, had_clip ? &old : NULL);
+}
+
+// Text is rendered as white coverage and tinted with the vertex color when it's drawn
+static const SDL_Color text_white = { 0xFF, 0xFF, 0xFF, 0xFF };
+
+static SDL_Surface* render_text(TTF_Font* font, const string& str, int style) {
 	int old = TTF_GetFontStyle(font);
 	TTF_SetFontStyle(font, style);
-	SDL_Surface* src = TTF_RenderUTF8_Blended(font, str, col);
+	SDL_Surface* src = TTF_RenderUTF8_Blended(font, str.c_str(), text_white);
 	TTF_SetFontStyle(font, old);
+	return src;
+}
 
-	if (src) {
-		SDL_Texture* tex = SDL_CreateTextureFromSurface(config.mRenderer, src);
-		if (tex) {
+static SDL_Surface* render_text_wrapped(TTF_Font* font, const string& str, int style, uint8 align, int wrap_width) {
+	int old = TTF_GetFontStyle(font);
+	TTF_SetFontStyle(font, style);
+	int orig_wrap = TTF_GetFontWrappedAlign(font);
+	if (align & DTA_CENTER) {
+		TTF_SetFontWrappedAlign(font, TTF_WRAPPED_ALIGN_CENTER);
+	} else if (align & DTA_RIGHT) {
+		TTF_SetFontWrappedAlign(font, TTF_WRAPPED_ALIGN_RIGHT);
+	} else {
+		TTF_SetFontWrappedAlign(font, TTF_WRAPPED_ALIGN_LEFT);
+	}
+	SDL_Surface* src = TTF_RenderUTF8_Blended_Wrapped(font, str.c_str(), text_white, wrap_width);
+	TTF_SetFontWrappedAlign(font, orig_wrap);
+	TTF_SetFontStyle(font, old);
+	return src;
+}
 
-			SDL_Rect rc; //create a rect
-			rc.x = x;  //controls the rect's x coordinate
-			rc.y = y; // controls the rect's y coordinte
-			rc.w = src->w; // controls the width of the rect
-			rc.h = src->h; // controls the height of the rect
+static TEXT_CACHE_KEY line_key(TTF_Font* font, const string& str, int style) {
+	return TEXT_CACHE_KEY(font, 0, style, 0, 0, 0, 0, str);
+}
 
-			SDL_RenderCopy(config.mRenderer, tex, NULL, &rc);
+static TEXT_CACHE_KEY wrapped_key(TTF_Font* font, int wrap_width, uint8 align, const string& str, int style) {
+	return TEXT_CACHE_KEY(font, 0, style, wrap_width, 0, 0, align, str);
+}
 
-			SDL_DestroyTexture(tex);
-		}
-		SDL_FreeSurface(src);
+TEXT_CACHE_KEY text_job_key(const TEXT_JOB& job) {
+	switch (job.type) {
+		case TJ_FIXED:
+			return line_key(GetFontSize(job.ptSize), job.str, job.style);
+		case TJ_FIXED_WRAPPED:
+			return wrapped_key(GetFontSize(job.ptSize), job.rc.w, job.align, job.str, job.style);
+		case TJ_FIT:
+			return TEXT_CACHE_KEY(NULL, job.ptSize, job.style, 0, job.rc.w, job.rc.h, 0, job.str);
+		case TJ_FIT_WRAPPED:
+		default:
+			return TEXT_CACHE_KEY(NULL, job.ptSize, job.style, job.rc.w, job.rc.w, job.rc.h, job.align, job.str);
 	}
 }
 
-void draw_text(TTF_Font* font, const SDL_Rect& rc, uint8 align, const SDL_Color& col, const string& str, int style) {
+SDL_Surface* text_job_render(const TEXT_JOB& job, TextFitter& fitter) {
+	int ptSize = job.ptSize;
+	if (job.type == TJ_FIT) {
+		ptSize = fitter.FitSize(job.str, job.ptSize, { job.rc.w, job.rc.h }, job.style, TFF_WIDTH | TFF_HEIGHT);
+	} else if (job.type == TJ_FIT_WRAPPED) {
+		ptSize = fitter.FitSize(job.str, job.ptSize, { job.rc.w, job.rc.h }, job.style, TFF_HEIGHT | TFF_WRAPPED);
+	}
+
+	auto font = fitter.GetFont(ptSize);
 	if (font == NULL) {
-		font = config.backup_font;
+		return NULL;
+	}
+	if (job.type == TJ_FIXED_WRAPPED || job.type == TJ_FIT_WRAPPED) {
+		return render_text_wrapped(font, job.str, job.style, job.align, job.rc.w);
 	}
+	return render_text(font, job.str, job.style);
+}
 
-	int old = TTF_GetFontStyle(font);
-	TTF_SetFontStyle(font, style);
-	SDL_Surface* src = TTF_RenderUTF8_Blended(font, str.c_str(), col);
-	TTF_SetFontStyle(font, old);
+// Uploads src into the text cache and frees it
+static const SPRITE* cache_text_surface(const TEXT_CACHE_KEY& key, SDL_Surface* src) {
+	if (src == NULL) {
+		return NULL;
+	}
+	const SPRITE* ret = text_cache_add(key, src);
+	SDL_FreeSurface(src);
+	return ret;
+}
 
-	if (src) {
-		SDL_Texture* tex = SDL_CreateTextureFromSurface(config.mRenderer, src);
-		if (tex) {
-
-			SDL_Rect rc2;
-			rc2.y = rc.y;
-			rc2.w = src->w;
-			rc2.h = src->h;
-			if (align & DTA_RIGHT) {
-				rc2.x = rc.x + rc.w - src->w;
-			} else if (align & DTA_CENTER) {
-				rc2.y = rc.y;
-				rc2.x = rc.x + ((rc.w - src->w) / 2);
-			} else {
-				rc2.x = rc.x;
-			}
-			if (align & DTA_MIDDLE) {
-				rc2.y += (rc.h - src->h) / 2;
-			} else if (align & DTA_BOTTOM) {
-				rc2.y += rc.h - src->h - 1;
-			}
+// Positions a cached text sprite inside rc and draws it clipped to rc
+static void blit_text(const SPRITE* s, const SDL_Rect& rc, uint8 align, const SDL_Color& col, bool wrapped) {
+	SDL_Rect rc2;
+	rc2.y = rc.y;
+	rc2.w = s->rc.w;
+	rc2.h = s->rc.h;
+	if (wrapped) {
+		// SDL_ttf already applied the horizontal alignment to wrapped text
+		rc2.x = rc.x;
+	} else if (align & DTA_RIGHT) {
+		rc2.x = rc.x + rc.w - rc2.w;
+	} else if (align & DTA_CENTER) {
+		rc2.x = rc.x + ((rc.w - rc2.w) / 2);
+	} else {
+		rc2.x = rc.x;
+	}
+	if (align & DTA_MIDDLE) {
+		rc2.y += (rc.h - rc2.h) / 2;
+	} else if (align & DTA_BOTTOM) {
+		rc2.y += rc.h - rc2.h - 1;
+	}
 
-			SDL_Rect clip = { 0,0,0,0 };
-			SDL_RenderGetClipRect(config.mRenderer, &clip);
-			SDL_RenderSetClipRect(config.mRenderer, &rc);
-			SDL_RenderCopy(config.mRenderer, tex, NULL, &rc2);
-			SDL_RenderSetClipRect(config.mRenderer, (clip.w || clip.h) ? &clip : NULL);
+	draw_sprite(*s, rc2, col, &rc);
+}
 
-			SDL_DestroyTexture(tex);
-		}
-		SDL_FreeSurface(src);
+void draw_text(TTF_Font* font, int x, int y, const SDL_Color& col, const char* str, int style) {
+	if (font == NULL) {
+		font = config.backup_font;
+	}
+
+	auto key = line_key(font, str, style);
+	const SPRITE* s = text_cache_find(key);
+	if (s == NULL) {
+		s = cache_text_surface(key, render_text(font, str, style));
+	}
+	if (s != NULL) {
+		draw_sprite(*s, { x, y, s->rc.w, s->rc.h }, col);
 	}
 }
 
-void draw_text(int ptSize, const SDL_Rect& rc, uint8 align, const SDL_Color& col, const string& str, int style) {
-	int w, h;
+void draw_text(TTF_Font* font, const SDL_Rect& rc, uint8 align, const SDL_Color& col, const string& str, int style) {
+	if (font == NULL) {
+		font = config.backup_font;
+	}
 
-	bool done = false;
-	while (!done) {
-		auto font = GetFontSize(ptSize);
+	auto key = line_key(font, str, style);
+	const SPRITE* s = text_cache_find(key);
+	if (s == NULL) {
+		s = cache_text_surface(key, render_text(font, str, style));
+	}
+	if (s != NULL) {
+		blit_text(s, rc, align, col, false);
+	}
+}
 
-		int old = TTF_GetFontStyle(font);
-		TTF_SetFontStyle(font, style);
+// What was last drawn in each place with draw_text(job), shown while the worker renders its replacement
+static map<string, TEXT_CACHE_KEY> text_slots;
+#define TEXT_SLOTS_MAX_ENTRIES 1024
 
-		TTF_SizeUTF8(font, str.c_str(), &w, &h);
+static string text_slot(const TEXT_JOB& job) {
+	return mprintf("%d,%d,%d,%d,%d,%d", job.type, job.ptSize, job.rc.x, job.rc.y, job.rc.w, job.rc.h);
+}
 
-		if ((w <= rc.w && h <= rc.h) || ptSize <= 10) {
-			draw_text(font, rc, align, col, str, style);
-			done = true;
+void draw_text(const TEXT_JOB& job) {
+	const bool wrapped = (job.type == TJ_FIXED_WRAPPED || job.type == TJ_FIT_WRAPPED);
+	auto key = text_job_key(job);
+	const SPRITE* s = text_cache_find(key);
+	if (!text_async_enabled()) {
+		if (s == NULL) {
+			s = cache_text_surface(key, text_job_render(job, text_fitter));
+		}
+		if (s != NULL) {
+			blit_text(s, job.rc, job.align, job.col, wrapped);
+		}
+		return;
+	}
+
+	string slot = text_slot(job);
+	if (s != NULL) {
+		blit_text(s, job.rc, job.align, job.col, wrapped);
+		auto x = text_slots.find(slot);
+		if (x != text_slots.end()) {
+			x->second = key;
+		} else {
+			if (text_slots.size() >= TEXT_SLOTS_MAX_ENTRIES) {
+				text_slots.clear();
+			}
+			text_slots.emplace(slot, key);
 		}
+		return;
+	}
 
-		TTF_SetFontStyle(font, old);
-		ptSize -= 2;
+	text_async_request_cached(key, job);
+	text_async_note_pending();
+	auto x = text_slots.find(slot);
+	if (x != text_slots.end() && (s = text_cache_find(x->second)) != NULL) {
+		blit_text(s, job.rc, job.align, job.col, wrapped);
 	}
 }
 
+void draw_text(int ptSize, const SDL_Rect& rc, uint8 align, const SDL_Color& col, const string& str, int style) {
+	TEXT_JOB job;
+	job.type = TJ_FIT;
+	job.ptSize = ptSize;
+	job.rc = rc;
+	job.align = align;
+	job.col = col;
+	job.str = str;
+	job.style = style;
+	draw_text(job);
+}
+
 void draw_text_wrapped(TTF_Font* font, const SDL_Rect& rc, uint8 align, const SDL_Color& col, const string& str, int style) {
 	if (font == NULL) {
 		font = config.backup_font;
 	}
 
-	int old = TTF_GetFontStyle(font);
-	TTF_SetFontStyle(font, style);
-	int orig_wrap = TTF_GetFontWrappedAlign(font);
-	if (align & DTA_CENTER) {
-		TTF_SetFontWrappedAlign(font, TTF_WRAPPED_ALIGN_CENTER);
-	} else if (align & DTA_RIGHT) {
-		TTF_SetFontWrappedAlign(font, TTF_WRAPPED_ALIGN_RIGHT);
-	} else {
-		TTF_SetFontWrappedAlign(font, TTF_WRAPPED_ALIGN_LEFT);
+	auto key = wrapped_key(font, rc.w, align, str, style);
+	const SPRITE* s = text_cache_find(key);
+	if (s == NULL) {
+		s = cache_text_surface(key, render_text_wrapped(font, str, style, align, rc.w));
 	}
-	SDL_Surface* src = TTF_RenderUTF8_Blended_Wrapped(font, str.c_str(), col, rc.w);
-	TTF_SetFontWrappedAlign(font, orig_wrap);
-	TTF_SetFontStyle(font, old);
-	if (src) {
-		SDL_Texture* tex = SDL_CreateTextureFromSurface(config.mRenderer, src);
-		if (tex) {
-
-			SDL_Rect rc2;
-			rc2.y = rc.y;
-			rc2.w = src->w;
-			rc2.h = src->h;
-			rc2.x = rc.x;
-			if (align & DTA_MIDDLE) {
-				rc2.y += (rc.h - src->h) / 2;
-			} else if (align & DTA_BOTTOM) {
-				rc2.y += rc.h - src->h - 1;
-			}
-
-			SDL_Rect clip = { 0,0,0,0 };
-			SDL_RenderGetClipRect(config.mRenderer, &clip);
-			SDL_RenderSetClipRect(config.mRenderer, &rc);
-			SDL_RenderCopy(config.mRenderer, tex, NULL, &rc2);
-			SDL_RenderSetClipRect(config.mRenderer, (clip.w || clip.h) ? &clip : NULL);
-
-			SDL_DestroyTexture(tex);
-		}
-		SDL_FreeSurface(src);
+	if (s != NULL) {
+		blit_text(s, rc, align, col, true);
 	}
 }
 
 void draw_text_wrapped(int ptSize, const SDL_Rect& rc, uint8 align, const SDL_Color& col, const string& str, int style) {
-	int h = rc.h + 10;
-
-	SDL_Surface* src = NULL;
-	while (h > rc.h && ptSize > 10) {
-		auto font = GetFontSize(ptSize);
-
-		int old = TTF_GetFontStyle(font);
-		TTF_SetFontStyle(font, style);
-		int orig_wrap = TTF_GetFontWrappedAlign(font);
-		if (align & DTA_CENTER) {
-			TTF_SetFontWrappedAlign(font, TTF_WRAPPED_ALIGN_CENTER);
-		} else if (align & DTA_RIGHT) {
-			TTF_SetFontWrappedAlign(font, TTF_WRAPPED_ALIGN_RIGHT);
-		} else {
-			TTF_SetFontWrappedAlign(font, TTF_WRAPPED_ALIGN_LEFT);
-		}
-
-		if (src != NULL) {
-			SDL_FreeSurface(src);
-		}
-		src = TTF_RenderUTF8_Blended_Wrapped(font, str.c_str(), col, rc.w);
-		if (src != NULL) {
-			h = src->h;
-		}
+	TEXT_JOB job;
+	job.type = TJ_FIT_WRAPPED;
+	job.ptSize = ptSize;
+	job.rc = rc;
+	job.align = align;
+	job.col = col;
+	job.str = str;
+	job.style = style;
+	draw_text(job);
+}
 
-		TTF_SetFontWrappedAlign(font, orig_wrap);
-		TTF_SetFontStyle(font, old);
-		ptSize -= 2;
-	}
-
-	if (src) {
-		SDL_Texture* tex = SDL_CreateTextureFromSurface(config.mRenderer, src);
-		if (tex) {
-
-			SDL_Rect rc2;
-			rc2.y = rc.y;
-			rc2.w = src->w;
-			rc2.h = src->h;
-			/*
-			if (align & DTA_RIGHT) {
-				rc2.x = rc.x + rc.w - src->w;
-			} else if (align & DTA_CENTER) {
-				rc2.y = rc.y;
-				rc2.x = rc.x + ((rc.w - src->w) / 2);
-			} else {
-				rc2.x = rc.x;
+void CachedText::Update() {
+	if (spr.tex == NULL || stale) {
+		TEXT_JOB job;
+		job.type = TJ_FIT;
+		job.ptSize = font_size;
+		job.rc = rc;
+		job.str = str;
+		job.style = style;
+		if (str.empty()) {
+			freeSprite();
+			stale = false;
+		} else if (text_sprite_update(ticket, job, spr)) {
+			stale = false;
+			if (spr.page < 0) {
+				// Update() makes it again if the texture budget takes it
+				texture_set_evict(spr.tex, [this]() { freeSprite(); });
 			}
-			*/
-			rc2.x = rc.x;
-			if (align & DTA_MIDDLE) {
-				rc2.y += (rc.h - src->h) / 2;
-			} else if (align & DTA_BOTTOM) {
-				rc2.y += rc.h - src->h - 1;
-			}
-
-			SDL_Rect clip = { 0,0,0,0 };
-			SDL_RenderGetClipRect(config.mRenderer, &clip);
-			SDL_RenderSetClipRect(config.mRenderer, &rc);
-			SDL_RenderCopy(config.mRenderer, tex, NULL, &rc2);
-			SDL_RenderSetClipRect(config.mRenderer, (clip.w || clip.h) ? &clip : NULL);
-
-			SDL_DestroyTexture(tex);
 		}
-		SDL_FreeSurface(src);
 	}
+	// keeps it from being evicted while a scene is showing it without redrawing
+	texture_touch(spr.tex);
 }
 
-void CachedText::Draw() {
-	int h = rc.h + 10;
-	int w = rc.w + 10;
-	int ptSize = font_size;
-
-	if (tex == NULL) {
-		SDL_Surface* src = NULL;
-		while (src == NULL) {
-			auto font = GetFontSize(ptSize);
-
-			int old = TTF_GetFontStyle(font);
-			TTF_SetFontStyle(font, style);
-
-			TTF_SizeUTF8(font, str.c_str(), &w, &h);
-
-			if ((w <= rc.w && h <= rc.h) || ptSize <= 10) {
-				src = TTF_RenderUTF8_Blended(font, str.c_str(), col);
-				if (src != NULL) {
-					tex = SDL_CreateTextureFromSurface(config.mRenderer, src);
-					tex_size = { src->w, src->h };
-					SDL_FreeSurface(src);
-				} else {
-					break;
-				}
-			}
+void CachedText::GetState(string& state) {
+	state += mprintf("%d,%d,%d,%d|%02x%02x%02x%02x|%d,%d,%d|%p,%d,%d,%d,%d|", rc.x, rc.y, rc.w, rc.h, col.r, col.g, col.b, col.a, font_size, align, style, spr.tex, spr.rc.x, spr.rc.y, spr.rc.w, spr.rc.h);
+	state += str;
+	state += '\0';
+}
 
-			TTF_SetFontStyle(font, old);
-			ptSize -= 2;
-		}
+// Where the whole sprite goes, before clipping to rc
+SDL_Rect CachedText::destRect() const {
+	SDL_Rect rc2;
+	rc2.y = rc.y;
+	rc2.w = spr.rc.w;
+	rc2.h = spr.rc.h;
+	if (align & DTA_RIGHT) {
+		rc2.x = rc.x + rc.w - rc2.w;
+	} else if (align & DTA_CENTER) {
+		rc2.x = rc.x + ((rc.w - rc2.w) / 2);
+	} else {
+		rc2.x = rc.x;
 	}
-	
-	if (tex) {
-		SDL_Rect rc2;
-		rc2.y = rc.y;
-		rc2.w = tex_size.w;
-		rc2.h = tex_size.h;
-		if (align & DTA_RIGHT) {
-			rc2.x = rc.x + rc.w - tex_size.w;
-		} else if (align & DTA_CENTER) {
-			rc2.y = rc.y;
-			rc2.x = rc.x + ((rc.w - tex_size.w) / 2);
-		} else {
-			rc2.x = rc.x;
-		}
-		if (align & DTA_MIDDLE) {
-			rc2.y += (rc.h - tex_size.h) / 2;
-		} else if (align & DTA_BOTTOM) {
-			rc2.y += rc.h - tex_size.h - 1;
-		}
+	if (align & DTA_MIDDLE) {
+		rc2.y += (rc.h - rc2.h) / 2;
+	} else if (align & DTA_BOTTOM) {
+		rc2.y += rc.h - rc2.h - 1;
+	}
+	return rc2;
+}
 
-		SDL_Rect clip = { 0,0,0,0 };
-		SDL_RenderGetClipRect(config.mRenderer, &clip);
-		SDL_RenderSetClipRect(config.mRenderer, &rc);
-		SDL_RenderCopy(config.mRenderer, tex, NULL, &rc2);
-		SDL_RenderSetClipRect(config.mRenderer, (clip.w || clip.h) ? &clip : NULL);
+SDL_Rect CachedText::GetBounds() {
+	SDL_Rect ret = { 0, 0, 0, 0 };
+	if (spr.tex != NULL) {
+		SDL_Rect rc2 = destRect();
+		SDL_IntersectRect(&rc2, &rc, &ret);
+	}
+	return ret;
+}
+
+void CachedText::Draw() {
+	Update();
+	if (spr.tex != NULL) {
+		draw_sprite(spr, destRect(), col, &rc);
 	}
 }
 
@@ -278,9 +315,13 @@ string ts_to_str(time_t ts) {
 	return tm_to_str(tm);
 }
 
-string tm_to_str(const tm& tm) {
+string tm_to_str(const tm& tm, bool seconds) {
+	string secs;
+	if (seconds) {
+		secs = mprintf(":%02d", tm.tm_sec);
+	}
 	if (config.options.time_format == TF_24HOUR) {
-		return mprintf("%d:%02d", tm.tm_hour, tm.tm_min);
+		return mprintf("%d:%02d%s", tm.tm_hour, tm.tm_min, secs.c_str());
 	}
 
 	string hour, min, post;
@@ -294,7 +335,7 @@ string tm_to_str(const tm& tm) {
 	if (config.options.time_format == TF_12HOUR_SUFFIX) {
 		post = (tm.tm_hour >= 12) ? "p" : "a";
 	}
-	return mprintf("%s:%02d%s", hour.c_str(), tm.tm_min, post.c_str());
+	return mprintf("%s:%02d%s%s", hour.c_str(), tm.tm_min, secs.c_str(), post.c_str());
 }
 
 string FormatMinutes(int64 secs) {
@@ -332,6 +373,31 @@ string FormatMinutes(int64 secs) {
 	return sstr.str();
 }
 
+Uint64 ms_until_next_interval(int secs) {
+	int64 now = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
+	int64 period = int64(secs) * 1000;
+	// a few ms of slack so time(NULL) has definitely rolled over when we wake up
+	return Uint64(period - (now % period)) + 5;
+}
+
+time_t local_time_on(const struct tm& day, int hour, int minute) {
+	// when DST ends the hour happens twice, mktime() picks one of them depending on the flag
+	time_t ret = 0;
+	for (int isdst : { 0, 1 }) {
+		struct tm tm = day;
+		tm.tm_hour = hour;
+		tm.tm_min = minute;
+		tm.tm_sec = 0;
+		tm.tm_isdst = isdst;
+		time_t ts = mktime(&tm);
+		// a flag that doesn't fit moves it by an hour, and a time DST skips doesn't exist either way
+		if (ts >= 0 && tm.tm_hour == hour && tm.tm_min == minute && tm.tm_mday == day.tm_mday && (ret == 0 || ts < ret)) {
+			ret = ts;
+		}
+	}
+	return ret;
+}
+
 bool backup_file(const string& fn) {
 	if (access(fn.c_str(), 0) == 0) {
 		time_t ts = time(NULL);